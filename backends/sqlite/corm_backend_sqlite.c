@@ -77,6 +77,137 @@ static bool sqlite_prepare(corm_backend_conn_t conn, corm_backend_stmt_t* stmt,
     return true;
 }
 
+// Requests are rendered with numbered ?NNN parameters, so predicates can
+// refer to any parameter regardless of where they end up in the text
+static const char* sqlite_cmp_op(corm_cmp_e cmp) {
+    switch (cmp) {
+        case CORM_CMP_EQ: return "=";
+        case CORM_CMP_NE: return "<>";
+        case CORM_CMP_LT: return "<";
+        case CORM_CMP_LE: return "<=";
+        case CORM_CMP_GT: return ">";
+        case CORM_CMP_GE: return ">=";
+    }
+    return "=";
+}
+
+static void sqlite_append_predicate(sqlite3_str* sql, const corm_predicate_t* p, bool nested) {
+    switch (p->kind) {
+        case CORM_PRED_CMP:
+            sqlite3_str_appendf(sql, "\"%w\" %s ?%d", p->column, sqlite_cmp_op(p->cmp), p->param);
+            return;
+
+        case CORM_PRED_RAW: {
+            if (nested) sqlite3_str_appendchar(sql, 1, '(');
+            // Only ? outside string literals and quoted names are parameters
+            int param = p->param;
+            char quote = 0;
+            for (const char* c = p->sql; *c; c++) {
+                if (quote) {
+                    if (*c == quote) quote = 0;
+                    sqlite3_str_appendchar(sql, 1, *c);
+                } else if (*c == '?') {
+                    sqlite3_str_appendf(sql, "?%d", param++);
+                } else {
+                    if (*c == '\'' || *c == '"' || *c == '`') quote = *c;
+                    if (*c == '[') quote = ']';
+                    sqlite3_str_appendchar(sql, 1, *c);
+                }
+            }
+            if (nested) sqlite3_str_appendchar(sql, 1, ')');
+            return;
+        }
+
+        case CORM_PRED_IN:
+            sqlite3_str_appendf(sql, "\"%w\" IN (", p->column);
+            for (int i = 0; i < p->count; i++) {
+                sqlite3_str_appendf(sql, i > 0 ? ", ?%d" : "?%d", p->param + i);
+            }
+            sqlite3_str_appendchar(sql, 1, ')');
+            return;
+
+        case CORM_PRED_AND:
+        case CORM_PRED_OR:
+            if (nested) sqlite3_str_appendchar(sql, 1, '(');
+            sqlite_append_predicate(sql, p->left, true);
+            sqlite3_str_appendall(sql, p->kind == CORM_PRED_AND ? " AND " : " OR ");
+            sqlite_append_predicate(sql, p->right, true);
+            if (nested) sqlite3_str_appendchar(sql, 1, ')');
+            return;
+    }
+}
+
+static void sqlite_append_request(sqlite3_str* sql, const corm_request_t* req) {
+    switch (req->op) {
+        case CORM_REQUEST_SELECT:
+            sqlite3_str_appendall(sql, "SELECT ");
+            if (req->column_count == 0) sqlite3_str_appendchar(sql, 1, '*');
+            for (size_t i = 0; i < req->column_count; i++) {
+                sqlite3_str_appendf(sql, i > 0 ? ", \"%w\"" : "\"%w\"", req->columns[i].name);
+            }
+            sqlite3_str_appendf(sql, " FROM \"%w\"", req->table);
+            break;
+
+        case CORM_REQUEST_INSERT:
+            sqlite3_str_appendf(sql, "INSERT INTO \"%w\" (", req->table);
+            for (size_t i = 0; i < req->column_count; i++) {
+                sqlite3_str_appendf(sql, i > 0 ? ", \"%w\"" : "\"%w\"", req->columns[i].name);
+            }
+            sqlite3_str_appendall(sql, ") VALUES (");
+            for (size_t i = 0; i < req->column_count; i++) {
+                sqlite3_str_appendf(sql, i > 0 ? ", ?%d" : "?%d", (int)i + 1);
+            }
+            sqlite3_str_appendchar(sql, 1, ')');
+            break;
+
+        case CORM_REQUEST_UPDATE:
+            sqlite3_str_appendf(sql, "UPDATE \"%w\" SET ", req->table);
+            for (size_t i = 0; i < req->column_count; i++) {
+                const char* name = req->columns[i].name;
+                if (i > 0) sqlite3_str_appendall(sql, ", ");
+                if (req->columns[i].add) {
+                    sqlite3_str_appendf(sql, "\"%w\" = \"%w\" + ?%d", name, name, (int)i + 1);
+                } else {
+                    sqlite3_str_appendf(sql, "\"%w\" = ?%d", name, (int)i + 1);
+                }
+            }
+            break;
+
+        case CORM_REQUEST_DELETE:
+            sqlite3_str_appendf(sql, "DELETE FROM \"%w\"", req->table);
+            break;
+    }
+
+    if (req->where) {
+        sqlite3_str_appendall(sql, " WHERE ");
+        sqlite_append_predicate(sql, req->where, false);
+    }
+    if (req->order_by) {
+        sqlite3_str_appendf(sql, " ORDER BY %s", req->order_by);
+    }
+    if (req->limit != -1 || req->offset > 0) {
+        sqlite3_str_appendf(sql, " LIMIT %d", req->limit);
+        if (req->offset > 0) sqlite3_str_appendf(sql, " OFFSET %d", req->offset);
+    }
+}
+
+static bool sqlite_prepare_request(corm_backend_conn_t conn, corm_backend_stmt_t* stmt,
+                                   const corm_request_t* request, char** error) {
+    sqlite3_str* str = sqlite3_str_new((sqlite3*)conn);
+    sqlite_append_request(str, request);
+
+    if (sqlite3_str_errcode(str) != SQLITE_OK) {
+        sqlite3_free(sqlite3_str_finish(str));
+        if (error) *error = strdup("out of memory building statement");
+        return false;
+    }
+
+    char* sql = sqlite3_str_finish(str);
+    bool ok = sqlite_prepare(conn, stmt, sql, error);
+    sqlite3_free(sql);
+    return ok;
+}
+
 static void sqlite_finalize(corm_backend_stmt_t stmt) {
     if (stmt) {
         sqlite3_finalize((sqlite3_stmt*)stmt);
@@ -111,12 +242,25 @@ static bool sqlite_bind_null(corm_backend_stmt_t stmt, int index) {
     return sqlite3_bind_null((sqlite3_stmt*)stmt, index) == SQLITE_OK;
 }
 
+// Busy and locked are only worth retrying outside an explicit transaction.
+// Inside one SQLite wants a rollback first, the locks held would otherwise
+// keep the other side waiting on us.
+static int sqlite_step_error(sqlite3_stmt* s, int rc) {
+    if (rc == SQLITE_INTERRUPT) return CORM_STEP_INTERRUPTED;
+    if (!sqlite3_get_autocommit(sqlite3_db_handle(s))) return CORM_STEP_ERROR;
+    switch (rc & 0xff) {
+        case SQLITE_BUSY:   return CORM_STEP_BUSY;
+        case SQLITE_LOCKED: return CORM_STEP_LOCKED;
+        default:            return CORM_STEP_ERROR;
+    }
+}
+
 static int sqlite_step(corm_backend_stmt_t stmt) {
     int rc = sqlite3_step((sqlite3_stmt*)stmt);
     
-    if (rc == SQLITE_ROW) return 1;
-    if (rc == SQLITE_DONE) return 0;
-    return -1;
+    if (rc == SQLITE_ROW) return CORM_STEP_ROW;
+    if (rc == SQLITE_DONE) return CORM_STEP_DONE;
+    return sqlite_step_error((sqlite3_stmt*)stmt, rc);
 }
 
 static int sqlite_column_count(corm_backend_stmt_t stmt) {
@@ -164,13 +308,136 @@ static int sqlite_column_bytes(corm_backend_stmt_t stmt, int index) {
     return sqlite3_column_bytes((sqlite3_stmt*)stmt, index);
 }
 
+static bool sqlite_fetch_column(sqlite3_stmt* s, const corm_row_plan_t* plan,
+                                const corm_column_plan_t* col, char* row) {
+    void* field = row + col->offset;
+
+    switch (col->type) {
+        case FIELD_TYPE_INT:
+            *(int*)field = sqlite3_column_int(s, col->index);
+            return true;
+        case FIELD_TYPE_BOOL:
+            *(bool*)field = sqlite3_column_int(s, col->index) != 0;
+            return true;
+        case FIELD_TYPE_INT64:
+            *(int64_t*)field = sqlite3_column_int64(s, col->index);
+            return true;
+        case FIELD_TYPE_FLOAT:
+            *(float*)field = (float)sqlite3_column_double(s, col->index);
+            return true;
+        case FIELD_TYPE_DOUBLE:
+            *(double*)field = sqlite3_column_double(s, col->index);
+            return true;
+        case FIELD_TYPE_STRING: {
+            const unsigned char* text = sqlite3_column_text(s, col->index);
+            if (!text) return true;
+            size_t len = (size_t)sqlite3_column_bytes(s, col->index);
+            char* str = plan->alloc(plan->alloc_ctx, len + 1);
+            if (!str) return false;
+            memcpy(str, text, len + 1);
+            *(char**)field = str;
+            return true;
+        }
+        case FIELD_TYPE_BLOB: {
+            const void* data = sqlite3_column_blob(s, col->index);
+            int size = sqlite3_column_bytes(s, col->index);
+            if (!data || size <= 0) return true;
+            void* copy = plan->alloc(plan->alloc_ctx, (size_t)size);
+            if (!copy) return false;
+            memcpy(copy, data, (size_t)size);
+            ((blob_t*)field)->data = copy;
+            ((blob_t*)field)->size = (size_t)size;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static int sqlite_fetch_rows(corm_backend_stmt_t stmt, const corm_row_plan_t* plan,
+                             void* out_buf, int max_rows) {
+    sqlite3_stmt* s = (sqlite3_stmt*)stmt;
+    char* row = (char*)out_buf;
+
+    int count = 0;
+    while (count < max_rows) {
+        int rc = sqlite3_step(s);
+        if (rc == SQLITE_DONE) break;
+        if (rc != SQLITE_ROW) return count == 0 ? sqlite_step_error(s, rc) : CORM_STEP_ERROR;
+
+        for (size_t i = 0; i < plan->count; i++) {
+            const corm_column_plan_t* col = &plan->columns[i];
+            if (sqlite3_column_type(s, col->index) == SQLITE_NULL) continue;
+            if (!sqlite_fetch_column(s, plan, col, row)) return CORM_STEP_ERROR;
+        }
+
+        row += plan->row_size;
+        count++;
+    }
+    return count;
+}
+
+static bool sqlite_bind_row(corm_backend_stmt_t stmt, const corm_row_plan_t* plan, const void* instance) {
+    sqlite3_stmt* s = (sqlite3_stmt*)stmt;
+    const char* row = (const char*)instance;
+
+    for (size_t i = 0; i < plan->count; i++) {
+        const corm_column_plan_t* col = &plan->columns[i];
+        const void* field = row + col->offset;
+        int rc;
+
+        switch (col->type) {
+            case FIELD_TYPE_INT:
+                rc = sqlite3_bind_int(s, col->index, *(const int*)field);
+                break;
+            case FIELD_TYPE_BOOL:
+                rc = sqlite3_bind_int(s, col->index, *(const bool*)field ? 1 : 0);
+                break;
+            case FIELD_TYPE_INT64:
+                rc = sqlite3_bind_int64(s, col->index, *(const int64_t*)field);
+                break;
+            case FIELD_TYPE_FLOAT:
+                rc = sqlite3_bind_double(s, col->index, (double)*(const float*)field);
+                break;
+            case FIELD_TYPE_DOUBLE:
+                rc = sqlite3_bind_double(s, col->index, *(const double*)field);
+                break;
+            case FIELD_TYPE_STRING: {
+                const char* str = *(char* const*)field;
+                rc = str ? sqlite3_bind_text(s, col->index, str, -1, SQLITE_STATIC)
+                         : sqlite3_bind_null(s, col->index);
+                break;
+            }
+            case FIELD_TYPE_BLOB: {
+                const blob_t* blob = (const blob_t*)field;
+                rc = blob->data && blob->size > 0
+                   ? sqlite3_bind_blob(s, col->index, blob->data, (int)blob->size, SQLITE_STATIC)
+                   : sqlite3_bind_null(s, col->index);
+                break;
+            }
+            default:
+                return false;
+        }
+
+        if (rc != SQLITE_OK) return false;
+    }
+    return true;
+}
+
 static int64_t sqlite_last_insert_id(corm_backend_conn_t conn) {
     return sqlite3_last_insert_rowid((sqlite3*)conn);
 }
 
+static int64_t sqlite_changes(corm_backend_conn_t conn) {
+    return sqlite3_changes64((sqlite3*)conn);
+}
+
+// corm only opens transactions to write. Taking the write lock up front
+// means a busy database shows up here, where nothing is held yet, instead
+// of on the first write when this connection already has a read lock.
 static bool sqlite_begin_transaction(corm_backend_conn_t conn) {
     char* err = NULL;
-    return sqlite3_exec((sqlite3*)conn, "BEGIN TRANSACTION;", NULL, NULL, &err) == SQLITE_OK;
+    return sqlite3_exec((sqlite3*)conn, "BEGIN IMMEDIATE TRANSACTION;", NULL, NULL, &err) == SQLITE_OK;
 }
 
 static bool sqlite_commit(corm_backend_conn_t conn) {
@@ -258,6 +525,160 @@ static bool sqlite_set_foreign_keys(corm_backend_conn_t conn, bool enabled) {
     return sqlite3_exec((sqlite3*)conn, sql, NULL, NULL, &err) == SQLITE_OK;
 }
 
+static bool sqlite_enable_wal(corm_backend_conn_t conn) {
+    char* err = NULL;
+    return sqlite3_exec((sqlite3*)conn, "PRAGMA journal_mode = WAL;", NULL, NULL, &err) == SQLITE_OK;
+}
+
+static bool sqlite_set_read_only(corm_backend_conn_t conn, bool enabled) {
+    const char* sql = enabled ? "PRAGMA query_only = ON;" : "PRAGMA query_only = OFF;";
+    char* err = NULL;
+    return sqlite3_exec((sqlite3*)conn, sql, NULL, NULL, &err) == SQLITE_OK;
+}
+
+// VM instructions between progress handler calls, a few microseconds
+#define SQLITE_PROGRESS_OPS 1000
+
+static void sqlite_set_progress(corm_backend_conn_t conn, int (*handler)(void* ctx), void* ctx) {
+    sqlite3_progress_handler((sqlite3*)conn, handler ? SQLITE_PROGRESS_OPS : 0, handler, ctx);
+}
+
+static void sqlite_interrupt(corm_backend_conn_t conn) {
+    sqlite3_interrupt((sqlite3*)conn);
+}
+
+static bool sqlite_pragma(sqlite3* db, const char* sql, char** error) {
+    char* err_msg = NULL;
+    if (sqlite3_exec(db, sql, NULL, NULL, &err_msg) != SQLITE_OK) {
+        if (error) *error = strdup(err_msg ? err_msg : sqlite3_errmsg(db));
+        sqlite3_free(err_msg);
+        return false;
+    }
+    return true;
+}
+
+// PRAGMA journal_mode reports the mode it ended up in rather than failing
+static bool sqlite_set_journal_mode(sqlite3* db, const char* mode, char** error) {
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA journal_mode = %s;", mode);
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        if (error) *error = strdup(sqlite3_errmsg(db));
+        return false;
+    }
+
+    bool ok = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* got = (const char*)sqlite3_column_text(stmt, 0);
+        // In-memory databases only do "memory" (or "off") whatever is asked
+        const char* file = sqlite3_db_filename(db, "main");
+        ok = (got && sqlite3_stricmp(got, mode) == 0) || !file || !*file;
+        if (!ok && error) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "journal_mode stayed %s instead of %s", got ? got : "?", mode);
+            *error = strdup(msg);
+        }
+    } else if (error) {
+        *error = strdup(sqlite3_errmsg(db));
+    }
+
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+static bool sqlite_configure(corm_backend_conn_t conn, const corm_config_t* config, char** error) {
+    static const char* journal_modes[] = { NULL, "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF" };
+    static const char* sync_levels[] = { NULL, "OFF", "NORMAL", "FULL", "EXTRA" };
+    static const char* temp_stores[] = { NULL, "FILE", "MEMORY" };
+
+    sqlite3* db = (sqlite3*)conn;
+    char sql[96];
+
+    // Only possible while none of it is in use, so before anything else
+    if (config->lookaside_slot_size > 0 && config->lookaside_slots > 0 &&
+        sqlite3_db_config(db, SQLITE_DBCONFIG_LOOKASIDE, NULL,
+                          config->lookaside_slot_size, config->lookaside_slots) != SQLITE_OK) {
+        if (error) *error = strdup("lookaside memory is in use");
+        return false;
+    }
+
+    // Before the journal mode: a WAL database keeps the page size it has
+    if (config->page_size > 0) {
+        snprintf(sql, sizeof(sql), "PRAGMA page_size = %d;", config->page_size);
+        if (!sqlite_pragma(db, sql, error)) return false;
+    }
+    if (config->journal_mode != CORM_JOURNAL_DEFAULT &&
+        !sqlite_set_journal_mode(db, journal_modes[config->journal_mode], error)) {
+        return false;
+    }
+    if (config->synchronous != CORM_SYNCHRONOUS_DEFAULT) {
+        snprintf(sql, sizeof(sql), "PRAGMA synchronous = %s;", sync_levels[config->synchronous]);
+        if (!sqlite_pragma(db, sql, error)) return false;
+    }
+    if (config->mmap_size > 0) {
+        snprintf(sql, sizeof(sql), "PRAGMA mmap_size = %lld;", (long long)config->mmap_size);
+        if (!sqlite_pragma(db, sql, error)) return false;
+    }
+    if (config->cache_size_kib > 0) {
+        // Negative cache_size is in KiB rather than pages
+        snprintf(sql, sizeof(sql), "PRAGMA cache_size = -%lld;", (long long)config->cache_size_kib);
+        if (!sqlite_pragma(db, sql, error)) return false;
+    }
+    if (config->temp_store != CORM_TEMP_STORE_DEFAULT) {
+        snprintf(sql, sizeof(sql), "PRAGMA temp_store = %s;", temp_stores[config->temp_store]);
+        if (!sqlite_pragma(db, sql, error)) return false;
+    }
+    if (config->busy_timeout_ms > 0) {
+        sqlite3_busy_timeout(db, config->busy_timeout_ms);
+    }
+    if (config->soft_heap_limit > 0) {
+        sqlite3_soft_heap_limit64(config->soft_heap_limit);
+    }
+    return true;
+}
+
+static bool sqlite_list_tables(corm_backend_conn_t conn, void (*each)(void* ctx, const char* name), void* ctx) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2((sqlite3*)conn, "SELECT name FROM sqlite_master WHERE type='table';",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return false;
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        each(ctx, (const char*)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// The schema version is the one row of corm's own _corm_schema table.
+// PRAGMA user_version is left to the application.
+static bool sqlite_get_schema_version(corm_backend_conn_t conn, uint32_t* version) {
+    *version = 0;
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2((sqlite3*)conn, "SELECT version FROM _corm_schema WHERE id = 1;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        // Never synced, or a real error
+        return !sqlite_table_exists(conn, "_corm_schema");
+    }
+
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) *version = (uint32_t)sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW || rc == SQLITE_DONE;
+}
+
+static bool sqlite_set_schema_version(corm_backend_conn_t conn, uint32_t version) {
+    char sql[256];
+    snprintf(sql, sizeof(sql),
+             "CREATE TABLE IF NOT EXISTS _corm_schema (id INTEGER PRIMARY KEY, version INTEGER NOT NULL);"
+             "INSERT OR REPLACE INTO _corm_schema (id, version) VALUES (1, %u);", version);
+    return sqlite3_exec((sqlite3*)conn, sql, NULL, NULL, NULL) == SQLITE_OK;
+}
+
 static corm_backend_ops_t sqlite_ops = {
     .name = "sqlite",
     .connect = sqlite_connect,
@@ -265,6 +686,7 @@ static corm_backend_ops_t sqlite_ops = {
     .get_error = sqlite_get_error,
     .execute = sqlite_execute,
     .prepare = sqlite_prepare,
+    .prepare_request = sqlite_prepare_request,
     .finalize = sqlite_finalize,
     .reset = sqlite_reset,
     .bind_int = sqlite_bind_int,
@@ -283,7 +705,10 @@ static corm_backend_ops_t sqlite_ops = {
     .column_text = sqlite_column_text,
     .column_blob = sqlite_column_blob,
     .column_bytes = sqlite_column_bytes,
+    .fetch_rows = sqlite_fetch_rows,
+    .bind_row = sqlite_bind_row,
     .last_insert_id = sqlite_last_insert_id,
+    .changes = sqlite_changes,
     .begin_transaction = sqlite_begin_transaction,
     .commit = sqlite_commit,
     .rollback = sqlite_rollback,
@@ -294,8 +719,93 @@ static corm_backend_ops_t sqlite_ops = {
     .get_limit_syntax = sqlite_get_limit_syntax,
     .table_exists = sqlite_table_exists,
     .set_foreign_keys = sqlite_set_foreign_keys,
+    .enable_wal = sqlite_enable_wal,
+    .set_read_only = sqlite_set_read_only,
+    .set_progress = sqlite_set_progress,
+    .interrupt = sqlite_interrupt,
+    .configure = sqlite_configure,
+    .list_tables = sqlite_list_tables,
+    .get_schema_version = sqlite_get_schema_version,
+    .set_schema_version = sqlite_set_schema_version,
 };
 
 const corm_backend_ops_t* corm_backend_sqlite_init() {
     return &sqlite_ops;
 }
+
+// SQLite memory on a corm allocator. free_fn doesn't take a size and there
+// is no realloc, so each block carries its size in front of it; 16 bytes
+// keep the payload aligned the way malloc's would be.
+#define SQLITE_MEM_HEADER 16
+
+static struct {
+    void* ctx;
+    void* (*alloc_fn)(void*, size_t);
+    void (*free_fn)(void*, void*);
+} sqlite_allocator;
+
+static void* sqlite_mem_malloc(int size) {
+    char* block = sqlite_allocator.alloc_fn(sqlite_allocator.ctx, (size_t)size + SQLITE_MEM_HEADER);
+    if (!block) return NULL;
+    *(int*)block = size;
+    return block + SQLITE_MEM_HEADER;
+}
+
+static void sqlite_mem_free(void* ptr) {
+    if (ptr) sqlite_allocator.free_fn(sqlite_allocator.ctx, (char*)ptr - SQLITE_MEM_HEADER);
+}
+
+static int sqlite_mem_size(void* ptr) {
+    return ptr ? *(int*)((char*)ptr - SQLITE_MEM_HEADER) : 0;
+}
+
+static void* sqlite_mem_realloc(void* ptr, int size) {
+    void* grown = sqlite_mem_malloc(size);
+    if (!grown) return NULL;
+
+    int old_size = sqlite_mem_size(ptr);
+    memcpy(grown, ptr, (size_t)(old_size < size ? old_size : size));
+    sqlite_mem_free(ptr);
+    return grown;
+}
+
+static int sqlite_mem_roundup(int size) {
+    return (size + 7) & ~7;
+}
+
+static int sqlite_mem_init(void* app_data) {
+    (void)app_data;
+    return SQLITE_OK;
+}
+
+static void sqlite_mem_shutdown(void* app_data) {
+    (void)app_data;
+}
+
+bool corm_backend_sqlite_set_allocator(void* ctx, void* (*alloc_fn)(void*, size_t),
+                                       void (*free_fn)(void*, void*)) {
+    if (!alloc_fn || !free_fn) return false;
+
+    // The page cache allocates through these too, no SQLITE_CONFIG_PCACHE2 needed
+    static const sqlite3_mem_methods methods = {
+        sqlite_mem_malloc, sqlite_mem_free, sqlite_mem_realloc, sqlite_mem_size,
+        sqlite_mem_roundup, sqlite_mem_init, sqlite_mem_shutdown, NULL
+    };
+
+    void* old_ctx = sqlite_allocator.ctx;
+    void* (*old_alloc)(void*, size_t) = sqlite_allocator.alloc_fn;
+    void (*old_free)(void*, void*) = sqlite_allocator.free_fn;
+
+    sqlite_allocator.ctx = ctx;
+    sqlite_allocator.alloc_fn = alloc_fn;
+    sqlite_allocator.free_fn = free_fn;
+
+    // SQLITE_MISUSE once SQLite has initialized itself
+    if (sqlite3_config(SQLITE_CONFIG_MALLOC, &methods) != SQLITE_OK) {
+        sqlite_allocator.ctx = old_ctx;
+        sqlite_allocator.alloc_fn = old_alloc;
+        sqlite_allocator.free_fn = old_free;
+        return false;
+    }
+    return true;
+}
@@ -8,6 +8,11 @@
 
 #include "corm_backend.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Initial size of the model table, which grows as models are registered
 #ifndef CORM_MAX_MODELS
 #define CORM_MAX_MODELS 128
 #endif
@@ -20,19 +25,20 @@
 #define CORM_FREE free
 #endif
 
-typedef struct corm_arena_t corm_arena_t;
+#ifndef CORM_STMT_CACHE_CAPACITY
+#define CORM_STMT_CACHE_CAPACITY 256
+#endif
 
-typedef enum field_type_e {
-    FIELD_TYPE_INT,
-    FIELD_TYPE_INT64,
-    FIELD_TYPE_FLOAT,
-    FIELD_TYPE_DOUBLE,
-    FIELD_TYPE_STRING,
-    FIELD_TYPE_BOOL,
-    FIELD_TYPE_BLOB,
-    FIELD_TYPE_BELONGS_TO,
-    FIELD_TYPE_HAS_MANY
-} field_type_e;
+typedef struct corm_arena_t corm_arena_t;
+typedef struct corm_stmt_cache_t corm_stmt_cache_t;
+typedef struct corm_write_buffer_t corm_write_buffer_t;
+typedef struct corm_shared_t corm_shared_t;
+typedef struct corm_pool_t corm_pool_t;
+typedef struct corm_async_t corm_async_t;
+typedef struct corm_cancel_token_t corm_cancel_token_t;
+typedef struct corm_size_classes_t corm_size_classes_t;
+typedef struct corm_registry_t corm_registry_t;
+typedef struct corm_result_t corm_result_t;
 
 typedef struct {
     void* data;
@@ -63,15 +69,31 @@ typedef struct field_info_t {
     const char* fk_column_name;
     size_t count_offset;
     fk_delete_action_e on_delete;
+
+    // Resolved by corm_sync
     model_meta_t* related_model;
+    struct field_info_t* fk_field;
 } field_info_t;
 
+// Generated by DEFINE_MODEL_FAST. bind_row binds the fields whose bit is
+// set in `mask` (bit i = fields[i]) starting at parameter `param`, and
+// returns the next free parameter or -1. decode_row fills an instance from a
+// row whose columns are the model's columns in field order, and returns false
+// when a string or blob couldn't be copied into the result.
+typedef int  (*corm_bind_row_fn)(corm_db_t* db, corm_backend_stmt_t stmt, const void* instance,
+                                 uint64_t mask, int param);
+typedef bool (*corm_decode_row_fn)(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt,
+                                   void* instance);
+
 typedef struct model_meta_t {
     const char* table_name;
     size_t struct_size;
     field_info_t* fields;
     size_t field_count;
     field_info_t* primary_key_field;
+
+    corm_bind_row_fn bind_row;
+    corm_decode_row_fn decode_row;
 } model_meta_t;
 
 typedef struct {
@@ -80,15 +102,65 @@ typedef struct {
     void* ctx;
 } corm_allocator_t;
 
+typedef struct {
+    // Write-behind buffer
+    size_t   write_buffer_depth;
+    uint64_t write_buffer_saves;
+    uint64_t write_buffer_coalesced;
+    double   write_buffer_coalesce_ratio;
+    uint64_t flush_count;
+    uint64_t flush_last_ns;
+    uint64_t flush_max_ns;
+    uint64_t flush_total_ns;
+
+    // Busy or locked statements
+    uint64_t busy_retries;
+    uint64_t busy_wait_ns;
+    uint64_t busy_failures;  // given up on, busy_retry_ms had run out
+} corm_stats_t;
+
+typedef enum {
+    CORM_ERROR_NONE,
+    CORM_ERROR_GENERIC,
+    CORM_ERROR_TIMEOUT,    // a query ran past corm_query_timeout
+    CORM_ERROR_CANCELLED,  // a query's cancel token was triggered
+} corm_error_e;
+
 typedef struct corm_db_t {
     corm_backend_conn_t backend_conn;
     const corm_backend_ops_t* backend;
+    char* connection_string;
     corm_arena_t* internal_arena;
     corm_allocator_t allocator;
     model_meta_t** models;
     size_t model_count;
     size_t model_capacity;
+    corm_registry_t* registry;  // models by table name, fields by name
+    corm_stmt_cache_t* stmt_cache;
+    corm_result_t* tracked_results;
+    corm_write_buffer_t* write_buffer;
+    corm_stats_t stats;
+
+    // Shared mode: per-thread connections, and the handle they belong to
+    corm_shared_t* shared;
+    struct corm_db_t* parent;
+    bool synced;
+
+    // Read-only connections queries are spread over, if any
+    corm_pool_t* readers;
+
+    // Worker threads behind the *_async calls, if enabled
+    corm_async_t* async;
+
+    // Tuning from corm_configure, reapplied to every connection opened later
+    corm_config_t config;
+    bool has_config;
+
+    // Built-in allocator from corm_use_size_classes, owned by this handle
+    corm_size_classes_t* size_classes;
+
     char last_error[512];
+    corm_error_e last_error_code;
 } corm_db_t;
 
 typedef struct corm_result_t {
@@ -98,6 +170,18 @@ typedef struct corm_result_t {
     void** allocations;
     size_t allocation_count;
     size_t allocation_capacity;
+
+    // Rows data has room for, and the allocation strings and blobs are
+    // currently carved from
+    size_t capacity;
+    char*  chunk;
+    size_t chunk_used;
+    size_t chunk_size;
+
+    // Per-row field fingerprints, only set when the query tracked changes
+    uint64_t* snapshot;
+    corm_result_t* prev_tracked;
+    corm_result_t* next_tracked;
 } corm_result_t;
 
 #define NO_FLAGS 0
@@ -151,8 +235,8 @@ typedef enum {
 #define F_STRING(...) _DISPATCH(_F_STRING_, _NARGS(__VA_ARGS__))(__VA_ARGS__)
 
 #define _F_STRING_LEN_3(stype, fname, max_len) { _BASE_FIELD(stype, fname, FIELD_TYPE_STRING), .max_length = max_len }
-#define _F_STRING_LEN_4(stype, fname, max_len, fflags) { _BASE_FIELD(stype, fname, FIELD_TYPE_STRING), .max_length = max_len, .flags = fflags }
-#define _F_STRING_LEN_5(stype, fname, max_len, fflags, fval) { _BASE_FIELD(stype, fname, FIELD_TYPE_STRING), .max_length = max_len, .flags = fflags, .validator = fval }
+#define _F_STRING_LEN_4(stype, fname, max_len, fflags) { _BASE_FIELD(stype, fname, FIELD_TYPE_STRING), .flags = fflags, .max_length = max_len }
+#define _F_STRING_LEN_5(stype, fname, max_len, fflags, fval) { _BASE_FIELD(stype, fname, FIELD_TYPE_STRING), .flags = fflags, .max_length = max_len, .validator = fval }
 #define F_STRING_LEN(...) _DISPATCH(_F_STRING_LEN_, _NARGS(__VA_ARGS__))(__VA_ARGS__)
 
 #define _F_BOOL_2(stype, fname) { _BASE_FIELD(stype, fname, FIELD_TYPE_BOOL) }
@@ -194,15 +278,111 @@ typedef enum {
         .primary_key_field = NULL \
     }
 
+// DEFINE_MODEL_FAST takes an X-macro list instead of F_* arguments and also
+// generates straight-line bind/decode functions for the model, so saves and
+// queries skip the per-field type switch. Entries are X(KIND, stype, field,
+// ...) where KIND is the F_ macro's suffix and the rest are its arguments:
+//
+//   #define USER_FIELDS(X) X(INT, User, id, PRIMARY_KEY | AUTO_INC) X(STRING_LEN, User, name, 64)
+//   DEFINE_MODEL_FAST(User, User, USER_FIELDS);
+//
+// Models with more than 64 fields fall back to the generic path.
+bool corm_decode_string(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt, int col, char** out);
+bool corm_decode_blob(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt, int col, blob_t* out);
+
+#define _FAST_FIELD(kind, stype, fname, ...) F_##kind(stype, fname, ##__VA_ARGS__),
+
+#define _FAST_BIND_INT(db, s, p, v)        (db)->backend->bind_int(s, p, v)
+#define _FAST_BIND_BOOL(db, s, p, v)       (db)->backend->bind_int(s, p, (v) ? 1 : 0)
+#define _FAST_BIND_INT64(db, s, p, v)      (db)->backend->bind_int64(s, p, v)
+#define _FAST_BIND_FLOAT(db, s, p, v)      (db)->backend->bind_double(s, p, (double)(v))
+#define _FAST_BIND_DOUBLE(db, s, p, v)     (db)->backend->bind_double(s, p, v)
+#define _FAST_BIND_STRING(db, s, p, v)     ((v) ? (db)->backend->bind_string(s, p, v, -1) : (db)->backend->bind_null(s, p))
+#define _FAST_BIND_STRING_LEN(db, s, p, v) _FAST_BIND_STRING(db, s, p, v)
+#define _FAST_BIND_BLOB(db, s, p, v) \
+    ((v).data && (v).size > 0 ? (db)->backend->bind_blob(s, p, (v).data, (int)(v).size) : (db)->backend->bind_null(s, p))
+#define _FAST_BIND_BELONGS_TO(db, s, p, v)     true
+#define _FAST_BIND_HAS_MANY(db, s, p, v)       true
+#define _FAST_BIND_HAS_MANY_COUNT(db, s, p, v) true
+
+#define _FAST_BIND(kind, stype, fname, ...) \
+    if (mask & (1ULL << _fi)) { \
+        if (!_FAST_BIND_##kind(db, stmt, param, ((const stype*)instance)->fname)) return -1; \
+        param++; \
+    } \
+    _fi++;
+
+#define _FAST_DECODE_NUM(db, s, c, v, getter) \
+    if ((db)->backend->column_type(s, c) != 0) v = getter; \
+    c++;
+#define _FAST_DECODE_INT(db, r, s, c, v)        _FAST_DECODE_NUM(db, s, c, v, (db)->backend->column_int(s, c))
+#define _FAST_DECODE_BOOL(db, r, s, c, v)       _FAST_DECODE_NUM(db, s, c, v, (db)->backend->column_int(s, c) != 0)
+#define _FAST_DECODE_INT64(db, r, s, c, v)      _FAST_DECODE_NUM(db, s, c, v, (db)->backend->column_int64(s, c))
+#define _FAST_DECODE_FLOAT(db, r, s, c, v)      _FAST_DECODE_NUM(db, s, c, v, (float)(db)->backend->column_double(s, c))
+#define _FAST_DECODE_DOUBLE(db, r, s, c, v)     _FAST_DECODE_NUM(db, s, c, v, (db)->backend->column_double(s, c))
+#define _FAST_DECODE_STRING(db, r, s, c, v)     if (!corm_decode_string(db, r, s, c, &(v))) return false; c++;
+#define _FAST_DECODE_STRING_LEN(db, r, s, c, v) _FAST_DECODE_STRING(db, r, s, c, v)
+#define _FAST_DECODE_BLOB(db, r, s, c, v)       if (!corm_decode_blob(db, r, s, c, &(v))) return false; c++;
+#define _FAST_DECODE_BELONGS_TO(db, r, s, c, v)
+#define _FAST_DECODE_HAS_MANY(db, r, s, c, v)
+#define _FAST_DECODE_HAS_MANY_COUNT(db, r, s, c, v)
+
+#define _FAST_DECODE(kind, stype, fname, ...) \
+    _FAST_DECODE_##kind(db, result, stmt, _col, ((stype*)instance)->fname)
+
+#define DEFINE_MODEL_FAST(name, stype, list) \
+    static field_info_t name##_fields[] = { list(_FAST_FIELD) }; \
+    static int name##_bind_row(corm_db_t* db, corm_backend_stmt_t stmt, const void* instance, \
+                               uint64_t mask, int param) { \
+        int _fi = 0; \
+        list(_FAST_BIND) \
+        (void)_fi; \
+        return param; \
+    } \
+    static bool name##_decode_row(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt, \
+                                  void* instance) { \
+        int _col = 0; \
+        (void)result; \
+        list(_FAST_DECODE) \
+        (void)_col; \
+        return true; \
+    } \
+    static model_meta_t name##_model = { \
+        .table_name = #name, \
+        .struct_size = sizeof(stype), \
+        .fields = name##_fields, \
+        .field_count = sizeof(name##_fields) / sizeof(field_info_t), \
+        .primary_key_field = NULL, \
+        .bind_row = name##_bind_row, \
+        .decode_row = name##_decode_row \
+    }
+
 corm_db_t* corm_init(const char* db_filepath);
 
 corm_db_t* corm_init_with_allocator(const char* db_filepath, void* ctx,
                                     void* (*alloc_fn)(void*, size_t),
                                     void (*free_fn)(void*, void*));
 
+// Opens the usual read-write connection plus `readers` read-only ones and
+// switches the database to WAL. corm_query_exec (and so relation loading)
+// then runs on a free reader, unless the query asks to read its own writes.
+corm_db_t* corm_init_with_readers(const char* db_filepath, size_t readers);
+bool corm_enable_readers(corm_db_t* db, size_t readers);
+
+// In the CORM_STATIC_BACKEND=sqlite build the only backend is the built-in
+// SQLite one; these return NULL for any other ops table.
 corm_db_t* corm_init_with_backend(const corm_backend_ops_t* backend, 
                                    const char* connection_string);
 
+// Connection tuning. corm_configure applies config to db's connection and to
+// every connection corm opens for it afterwards (readers, pools, shared
+// mode), so call it before enabling those. Presets are "durable",
+// "throughput" and "bulk-load"; corm_config_preset returns false for other
+// names.
+bool       corm_config_preset(const char* name, corm_config_t* config);
+bool       corm_configure(corm_db_t* db, const corm_config_t* config);
+corm_db_t* corm_init_with_config(const char* db_filepath, const corm_config_t* config);
+
 corm_db_t* corm_init_with_backend_and_allocator(const corm_backend_ops_t* backend,
                                                  const char* connection_string,
                                                  void* ctx,
@@ -213,9 +393,48 @@ void corm_set_allocator(corm_db_t* db, void* ctx,
                         void* (*alloc_fn)(void*, size_t),
                         void (*free_fn)(void*, void*));
 
+typedef struct {
+    size_t block_size;
+    size_t reserved; // blocks carved out so far
+    size_t free;     // cached by threads or on the shared list
+    size_t in_use;
+} corm_size_class_stats_t;
+
+// Switches db to corm's size-class allocator with per-thread caches. Its
+// classes include the size of every model registered so far, so call it
+// after registering and before anything opens more connections (readers,
+// pools, shared mode) or holds results. Lives until corm_close.
+bool   corm_use_size_classes(corm_db_t* db);
+// Fills up to max entries and returns the number of classes
+size_t corm_size_class_stats(corm_db_t* db, corm_size_class_stats_t* stats, size_t max);
+
 void corm_close(corm_db_t* db);
 
+// Makes the handle safe to use from several threads at once. Each thread
+// transparently gets its own connection, arena and last error on first use.
+// Register models and corm_sync first, the registry is read-only afterwards.
+// Run a query, and free tracked results, on the thread that built them.
+// Needs a database file rather than ":memory:".
+bool corm_set_shared(corm_db_t* db, bool enabled);
+
+// The connection calls on db use from this thread: db itself unless it's
+// shared. For code that talks to db->backend directly.
+corm_db_t* corm_connection(corm_db_t* db);
+
+// SELECT <columns> FROM meta's table [WHERE where], prepared on a connection
+// from corm_connection, for typed front ends that bind and decode rows
+// themselves. `where` numbers its ? like corm_query_where and takes
+// param_count parameters of param_types. Give the statement back with
+// corm_select_release, never finalize it, and before closing conn. Until
+// then it's yours alone: other calls on conn, including another select of
+// the same shape, prepare their own instead of touching it.
+corm_backend_stmt_t corm_select_prepare(corm_db_t* conn, model_meta_t* meta, const char* const* columns,
+                                        size_t column_count, const char* where,
+                                        const field_type_e* param_types, size_t param_count);
+void                corm_select_release(corm_db_t* conn, corm_backend_stmt_t stmt);
+
 const char* corm_get_last_error(corm_db_t* db);
+corm_error_e corm_get_last_error_code(corm_db_t* db);
 
 bool corm_register_model(corm_db_t* db, model_meta_t* meta);
 bool corm_sync(corm_db_t* db, corm_sync_mode_e mode);
@@ -223,6 +442,40 @@ bool corm_sync(corm_db_t* db, corm_sync_mode_e mode);
 bool corm_save(corm_db_t* db, model_meta_t* meta, void* instance);
 bool corm_delete(corm_db_t* db, model_meta_t* meta, void* pk_value);
 
+// Write-behind: corm_save queues a copy of the instance instead of writing
+// it, and repeated saves of the same primary key collapse into the latest
+// one. The queue is written in one transaction once it holds max_entries
+// rows, once its oldest entry is max_delay_ms old (checked on save, 0 turns
+// the timer off), or on corm_flush. Other writes flush the queue first;
+// queries don't, call corm_flush when you need to read your own writes.
+// New AUTO_INC rows (key still 0) are written right away.
+//
+// A failed flush keeps the queue. Once it's full, saves of new keys fail
+// until a flush succeeds; corm_write_behind_discard drops the pending writes
+// and returns how many there were.
+bool corm_write_behind_enable(corm_db_t* db, size_t max_entries, uint32_t max_delay_ms);
+bool corm_write_behind_disable(corm_db_t* db);
+size_t corm_write_behind_discard(corm_db_t* db);
+bool corm_flush(corm_db_t* db);
+
+void corm_get_stats(corm_db_t* db, corm_stats_t* stats);
+
+// Bit i refers to meta->fields[i]. Build one with corm_field_mask and keep it
+// around for hot partial updates. Returns 0 (and sets the error) for unknown,
+// relation or primary key fields.
+typedef uint64_t corm_field_mask_t;
+
+corm_field_mask_t corm_field_mask(corm_db_t* db, model_meta_t* meta, const char** fields, size_t count);
+bool corm_update_mask(corm_db_t* db, model_meta_t* meta, void* instance, corm_field_mask_t mask);
+bool corm_update_fields(corm_db_t* db, model_meta_t* meta, void* instance, const char** fields, size_t count);
+
+// Both run a single UPDATE and return the number of affected rows, -1 on error.
+// corm_increment does `field = field + delta` for the row with the given key.
+// corm_update_if writes the whole row only if `field` still equals *expected,
+// 0 affected rows means someone else got there first.
+int64_t corm_increment(corm_db_t* db, model_meta_t* meta, void* pk_value, const char* field, int64_t delta);
+int64_t corm_update_if(corm_db_t* db, model_meta_t* meta, void* instance, const char* field, void* expected);
+
 typedef struct corm_query_t {
     corm_db_t*    db;
     model_meta_t* meta;
@@ -235,17 +488,148 @@ typedef struct corm_query_t {
     const char*   order_by;
     int           limit;
     int           offset;
+
+    bool          track_changes;
+    bool          read_your_writes;
+
+    int                  timeout_ms;
+    corm_cancel_token_t* cancel;
+
+    bool          caller_owned;  // set by corm_query_init, never freed by corm
 } corm_query_t;
 
 corm_query_t*  corm_query(corm_db_t* db, model_meta_t* meta);
+// Same as corm_query for a query that lives in the caller's memory, e.g. on
+// the stack. It isn't consumed by running it and can be run again.
+void           corm_query_init(corm_query_t* q, corm_db_t* db, model_meta_t* meta);
 void           corm_query_where(corm_query_t* q, const char* clause, void** params, field_type_e* types, size_t count);
 void           corm_query_order_by(corm_query_t* q, const char* order_by);
 void           corm_query_limit(corm_query_t* q, int limit);
 void           corm_query_offset(corm_query_t* q, int offset);
+void           corm_query_track_changes(corm_query_t* q, bool enabled);
+void           corm_query_read_your_writes(corm_query_t* q, bool enabled);
 corm_result_t* corm_query_exec(corm_query_t* q);
+// Runs q into *res, reusing the row and string memory of the result it held
+// the last time (pass *res == NULL the first time). An empty result isn't a
+// failure here, check (*res)->count. Free it with corm_free_result.
+bool           corm_query_exec_into(corm_query_t* q, corm_result_t** res);
+
+// Bounding a query. Past the timeout, or once the token is cancelled, the
+// running statement is stopped and the query fails with
+// CORM_ERROR_TIMEOUT / CORM_ERROR_CANCELLED. Applies to corm_query_exec,
+// corm_delete_where and corm_update_where. A token can be cancelled from
+// any thread and stays cancelled until reset.
+void corm_query_timeout(corm_query_t* q, int ms);
+void corm_query_cancel_token(corm_query_t* q, corm_cancel_token_t* token);
+
+corm_cancel_token_t* corm_cancel_token_create(void);
+void                 corm_cancel_token_destroy(corm_cancel_token_t* token);
+void                 corm_cancel(corm_cancel_token_t* token);
+void                 corm_cancel_token_reset(corm_cancel_token_t* token);
+bool                 corm_cancel_requested(corm_cancel_token_t* token);
+
+// Set based writes using the query's WHERE clause. Each runs as a single
+// statement, consumes q like corm_query_exec and returns the number of
+// affected rows, or -1 on error. The SET values bind before the WHERE params.
+int64_t        corm_delete_where(corm_query_t* q);
+int64_t        corm_update_where(corm_query_t* q, const char** fields, void** values, field_type_e* types, size_t count);
+
+// pks points at `count` contiguous primary key values (an int array for an
+// F_INT key). Large batches are chunked inside a single transaction.
+int64_t        corm_delete_many(corm_db_t* db, model_meta_t* meta, const void* pks, size_t count);
 
 corm_result_t* corm_load_relation(corm_db_t* db, model_meta_t* meta, void* instance, const char* field_name);
 
 void corm_free_result(corm_db_t* db, corm_result_t* result);
 
+// Group commit: any number of threads hand their writes to a coordinator,
+// which opens its own connection to the same database (so not ":memory:").
+// Writes arriving within window_us of each other, up to max_batch of them,
+// share one transaction and one commit. Each call blocks until its batch is
+// durable and reports its own outcome; error may be NULL. Start it after
+// corm_sync.
+typedef struct corm_group_commit_t corm_group_commit_t;
+
+corm_group_commit_t* corm_group_commit_start(corm_db_t* db, uint32_t window_us, size_t max_batch);
+void                 corm_group_commit_stop(corm_group_commit_t* gc);
+bool                 corm_group_save(corm_group_commit_t* gc, model_meta_t* meta, void* instance,
+                                     char* error, size_t error_size);
+bool                 corm_group_delete(corm_group_commit_t* gc, model_meta_t* meta, void* pk_value,
+                                       char* error, size_t error_size);
+
+// Single writer queue: producers push writes into a lock-free ring and a
+// dedicated thread owning its own connection drains it, max_batch writes per
+// transaction. Pass a future to learn the outcome (the instance must then
+// stay alive until the future is ready) or NULL to fire and forget, in which
+// case the instance is copied. A full ring blocks the producer unless
+// CORM_WRITER_NONBLOCK is given, then the call fails instead. A write that
+// can't be queued reports to its future, or without one sets the error on
+// db (the calling thread's handle when db is shared). max_batch can't be
+// larger than capacity.
+typedef struct corm_writer_t corm_writer_t;
+
+typedef struct {
+    int state;
+    bool ok;
+    char error[256];
+} corm_write_future_t;
+
+enum {
+    CORM_WRITER_NONBLOCK = (1 << 0),
+};
+
+corm_writer_t* corm_writer_start(corm_db_t* db, size_t capacity, size_t max_batch);
+void           corm_writer_stop(corm_writer_t* w);
+bool           corm_writer_save(corm_writer_t* w, model_meta_t* meta, void* instance,
+                                corm_write_future_t* future, int flags);
+bool           corm_writer_delete(corm_writer_t* w, model_meta_t* meta, void* pk_value,
+                                  corm_write_future_t* future, int flags);
+bool           corm_write_future_ready(corm_write_future_t* future);
+bool           corm_write_future_wait(corm_write_future_t* future);
+
+// Connection pool: up to 64 connections to the same database file, each with
+// its own arena, statement cache and error buffer. A checked out connection
+// is a regular corm_db_t owned by the calling thread until checkin; free its
+// results through it. Reads scale across threads best with WAL enabled.
+corm_pool_t* corm_pool_create(corm_db_t* db, size_t size);
+void         corm_pool_destroy(corm_pool_t* pool);
+corm_db_t*   corm_pool_checkout(corm_pool_t* pool);
+corm_db_t*   corm_pool_try_checkout(corm_pool_t* pool);
+void         corm_pool_checkin(corm_pool_t* pool, corm_db_t* conn);
+
+// Async execution: a few worker threads with their own connections to the
+// database (so not ":memory:") run queries and saves off the calling thread.
+// Completions queue up until corm_async_dispatch runs their callbacks on
+// whichever thread calls it; corm_async_fd becomes readable when there is
+// something to dispatch, so it can sit in an epoll/poll set. The callback
+// owns `result` and frees it with corm_free_result; a query that matched no
+// rows reports ok with a NULL result. Instances and query parameters must
+// stay alive until their callback has run.
+// corm_query_exec_async takes ownership of q.
+typedef void (*corm_async_fn)(corm_db_t* db, bool ok, corm_result_t* result,
+                              const char* error, void* userdata);
+
+bool   corm_async_enable(corm_db_t* db, size_t workers);
+void   corm_async_disable(corm_db_t* db);
+int    corm_async_fd(corm_db_t* db);
+size_t corm_async_dispatch(corm_db_t* db);
+bool   corm_query_exec_async(corm_query_t* q, corm_async_fn callback, void* userdata);
+bool   corm_save_async(corm_db_t* db, model_meta_t* meta, void* instance,
+                       corm_async_fn callback, void* userdata);
+
+// CORM_ASYNC_INLINE runs the callback right on the worker thread as soon as
+// the job is done, skipping the completion queue. The callback then must not
+// block and must be safe to run concurrently with the rest of the program.
+enum {
+    CORM_ASYNC_INLINE = (1 << 0),
+};
+
+bool   corm_query_exec_async_ex(corm_query_t* q, corm_async_fn callback, void* userdata, int flags);
+bool   corm_save_async_ex(corm_db_t* db, model_meta_t* meta, void* instance,
+                          corm_async_fn callback, void* userdata, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // CORM_H_
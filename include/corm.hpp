@@ -0,0 +1,431 @@
+#ifndef CORM_HPP_
+#define CORM_HPP_
+
+// C++17 typed facade.
+//
+//   DEFINE_MODEL(User, User, F_INT(User, id, PRIMARY_KEY | AUTO_INC), F_STRING(User, name), F_INT(User, age));
+//   CORM_MODEL(User, User, id, name, age);
+//
+//   corm::table<User> users(db);
+//   corm::rows<User> adults = users.select("age > ?", 18);
+//   for (User& u : adults) ...
+//
+// CORM_MODEL lists the column members of a model already described with
+// DEFINE_MODEL (relations are left out). Reads then select exactly those
+// columns in that order, and binding and decoding are picked per member
+// type at compile time instead of going through field_info_t at runtime.
+// Writes still go through corm_save so validators, change tracking and
+// write-behind keep working.
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<span>) && __cplusplus > 201703L
+#include <span>
+#endif
+
+#include "corm.h"
+
+namespace corm {
+
+class error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Move-only owner of a corm_result_t, freed with corm_free_result.
+class result {
+public:
+    result() noexcept = default;
+    result(corm_db_t* db, corm_result_t* res) noexcept : db_(db), res_(res) {}
+
+    result(result&& other) noexcept
+        : db_(std::exchange(other.db_, nullptr)), res_(std::exchange(other.res_, nullptr)) {}
+
+    result& operator=(result&& other) noexcept {
+        if (this != &other) {
+            reset();
+            db_ = std::exchange(other.db_, nullptr);
+            res_ = std::exchange(other.res_, nullptr);
+        }
+        return *this;
+    }
+
+    result(const result&) = delete;
+    result& operator=(const result&) = delete;
+
+    ~result() { reset(); }
+
+    void reset() noexcept {
+        if (res_) corm_free_result(db_, res_);
+        res_ = nullptr;
+    }
+
+    // Hands ownership back to the caller, who then calls corm_free_result
+    corm_result_t* release() noexcept { return std::exchange(res_, nullptr); }
+
+    corm_result_t* get() const noexcept { return res_; }
+    int size() const noexcept { return res_ ? res_->count : 0; }
+    bool empty() const noexcept { return size() == 0; }
+
+    template <typename T>
+    T* data() const noexcept { return res_ ? static_cast<T*>(res_->data) : nullptr; }
+
+    template <typename T>
+    T& at(int i) const noexcept { return data<T>()[i]; }
+
+private:
+    corm_db_t* db_ = nullptr;
+    corm_result_t* res_ = nullptr;
+};
+
+#if defined(__cpp_lib_span)
+template <typename T>
+using span = std::span<T>;
+#else
+// Just enough of std::span for C++17
+template <typename T>
+class span {
+public:
+    constexpr span() noexcept = default;
+    constexpr span(T* data, size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](size_t i) const noexcept { return data_[i]; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+#endif
+
+template <typename T, typename M>
+struct column {
+    const char* name;
+    M T::*member;
+};
+
+// Specialized by CORM_MODEL
+template <typename T>
+struct model;
+
+namespace detail {
+
+// Strings and blobs in decoded rows, owned by the rows object
+class owned_memory {
+public:
+    explicit owned_memory(const corm_allocator_t& allocator) noexcept : allocator_(allocator) {}
+
+    owned_memory(owned_memory&& other) noexcept
+        : allocator_(other.allocator_), blocks_(std::move(other.blocks_)) {
+        other.blocks_.clear();
+    }
+
+    owned_memory& operator=(owned_memory&& other) noexcept {
+        if (this != &other) {
+            release();
+            allocator_ = other.allocator_;
+            blocks_ = std::move(other.blocks_);
+            other.blocks_.clear();
+        }
+        return *this;
+    }
+
+    owned_memory(const owned_memory&) = delete;
+    owned_memory& operator=(const owned_memory&) = delete;
+
+    ~owned_memory() { release(); }
+
+    void* copy(const void* src, size_t size) {
+        void* dst = allocator_.alloc_fn ? allocator_.alloc_fn(allocator_.ctx, size) : CORM_MALLOC(size);
+        if (!dst) throw error("Failed to allocate column data");
+        blocks_.push_back(dst);
+        std::memcpy(dst, src, size);
+        return dst;
+    }
+
+private:
+    void release() noexcept {
+        for (void* block : blocks_) {
+            if (allocator_.alloc_fn) {
+                allocator_.free_fn(allocator_.ctx, block);
+            } else {
+                CORM_FREE(block);
+            }
+        }
+        blocks_.clear();
+    }
+
+    corm_allocator_t allocator_;
+    std::vector<void*> blocks_;
+};
+
+// Binders, one overload per parameter type
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, int v) {
+    return ops->bind_int(stmt, idx, v);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, bool v) {
+    return ops->bind_int(stmt, idx, v ? 1 : 0);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, long v) {
+    return ops->bind_int64(stmt, idx, (int64_t)v);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, long long v) {
+    return ops->bind_int64(stmt, idx, (int64_t)v);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, double v) {
+    return ops->bind_double(stmt, idx, v);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, float v) {
+    return ops->bind_double(stmt, idx, (double)v);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, const char* v) {
+    return v ? ops->bind_string(stmt, idx, v, -1) : ops->bind_null(stmt, idx);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, const std::string& v) {
+    return ops->bind_string(stmt, idx, v.c_str(), (int)v.size());
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, const blob_t& v) {
+    return v.data && v.size > 0 ? ops->bind_blob(stmt, idx, v.data, (int)v.size) : ops->bind_null(stmt, idx);
+}
+inline bool bind(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int idx, std::nullptr_t) {
+    return ops->bind_null(stmt, idx);
+}
+
+// The field type each parameter type binds as, for the statement's shape
+template <typename P>
+constexpr field_type_e param_type() noexcept {
+    using D = std::decay_t<P>;
+    if constexpr (std::is_same_v<D, bool>) return FIELD_TYPE_BOOL;
+    else if constexpr (std::is_same_v<D, int>) return FIELD_TYPE_INT;
+    else if constexpr (std::is_same_v<D, long> || std::is_same_v<D, long long>) return FIELD_TYPE_INT64;
+    else if constexpr (std::is_same_v<D, float>) return FIELD_TYPE_FLOAT;
+    else if constexpr (std::is_same_v<D, double>) return FIELD_TYPE_DOUBLE;
+    else if constexpr (std::is_same_v<D, blob_t>) return FIELD_TYPE_BLOB;
+    else if constexpr (std::is_same_v<D, std::nullptr_t>) return FIELD_TYPE_INT; // NULL binds alike under any type
+    else return FIELD_TYPE_STRING;
+}
+
+// Decoders, one overload per member type. NULL columns leave the member
+// zeroed, like the C path.
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory&, int& out) {
+    out = ops->column_int(stmt, col);
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory&, bool& out) {
+    out = ops->column_int(stmt, col) != 0;
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory&, int64_t& out) {
+    out = ops->column_int64(stmt, col);
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory&, float& out) {
+    out = (float)ops->column_double(stmt, col);
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory&, double& out) {
+    out = ops->column_double(stmt, col);
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory& mem, char*& out) {
+    const char* text = (const char*)ops->column_text(stmt, col);
+    if (text) out = (char*)mem.copy(text, std::strlen(text) + 1);
+}
+inline void decode(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, int col, owned_memory& mem, blob_t& out) {
+    const void* data = ops->column_blob(stmt, col);
+    int size = ops->column_bytes(stmt, col);
+    if (data && size > 0) {
+        out.data = mem.copy(data, (size_t)size);
+        out.size = (size_t)size;
+    }
+}
+
+template <typename T, typename Columns, size_t... I>
+inline void decode_row(const corm_backend_ops_t* ops, corm_backend_stmt_t stmt, owned_memory& mem,
+                       T& row, const Columns& cols, std::index_sequence<I...>) {
+    ((ops->column_type(stmt, (int)I) != 0
+          ? decode(ops, stmt, (int)I, mem, row.*(std::get<I>(cols).member))
+          : void()), ...);
+}
+
+// A select borrowed from the connection's statement cache
+class statement {
+public:
+    statement(corm_db_t* conn, model_meta_t* meta, const char* const* columns, size_t column_count,
+              const char* where, const field_type_e* param_types, size_t param_count)
+        : conn_(conn) {
+        stmt_ = corm_select_prepare(conn, meta, columns, column_count, where, param_types, param_count);
+        if (!stmt_) throw error(corm_get_last_error(conn));
+    }
+
+    statement(const statement&) = delete;
+    statement& operator=(const statement&) = delete;
+
+    ~statement() { corm_select_release(conn_, stmt_); }
+
+    corm_backend_stmt_t get() const noexcept { return stmt_; }
+
+private:
+    corm_db_t* conn_;
+    corm_backend_stmt_t stmt_ = nullptr;
+};
+
+} // namespace detail
+
+// Rows decoded straight into T, with the strings and blobs they point to.
+template <typename T>
+class rows {
+public:
+    explicit rows(const corm_allocator_t& allocator) : memory_(allocator) {}
+
+    rows(rows&&) noexcept = default;
+    rows& operator=(rows&&) noexcept = default;
+    rows(const rows&) = delete;
+    rows& operator=(const rows&) = delete;
+
+    span<T> view() noexcept { return span<T>(items_.data(), items_.size()); }
+    span<const T> view() const noexcept { return span<const T>(items_.data(), items_.size()); }
+
+    size_t size() const noexcept { return items_.size(); }
+    bool empty() const noexcept { return items_.empty(); }
+    T* begin() noexcept { return items_.data(); }
+    T* end() noexcept { return items_.data() + items_.size(); }
+    const T* begin() const noexcept { return items_.data(); }
+    const T* end() const noexcept { return items_.data() + items_.size(); }
+    T& operator[](size_t i) noexcept { return items_[i]; }
+    const T& operator[](size_t i) const noexcept { return items_[i]; }
+
+private:
+    template <typename> friend class table;
+
+    detail::owned_memory memory_;
+    std::vector<T> items_;
+};
+
+template <typename T>
+class table {
+public:
+    explicit table(corm_db_t* db) noexcept : db_(db) {}
+
+    // `where` may use ? placeholders, one parameter per ?. Anything after
+    // the condition (ORDER BY, LIMIT) can go in there as well. The statement
+    // is prepared once per connection and shape, like corm_query_exec.
+    template <typename... P>
+    rows<T> select(const char* where = nullptr, const P&... params) const {
+        corm_db_t* conn = corm_connection(db_);
+        if (!conn) throw error(corm_get_last_error(db_));
+
+        constexpr auto cols = model<T>::columns();
+        constexpr size_t n = std::tuple_size<decltype(cols)>::value;
+        static const auto names = column_names(std::make_index_sequence<n>{});
+        static const field_type_e types[sizeof...(P) + 1] = { detail::param_type<P>()... };
+
+        detail::statement stmt(conn, model<T>::meta(), names.data(), n, where, types, sizeof...(P));
+        const corm_backend_ops_t* ops = conn->backend;
+
+        int idx = 1;
+        bool bound = (detail::bind(ops, stmt.get(), idx++, params) && ...);
+        if (!bound) throw error("Failed to bind query parameters");
+
+        rows<T> out(conn->allocator);
+        int rc;
+        while ((rc = ops->step(stmt.get())) == 1) {
+            T& row = out.items_.emplace_back();
+            detail::decode_row(ops, stmt.get(), out.memory_, row, cols, std::make_index_sequence<n>{});
+        }
+        if (rc < 0) {
+            const char* err = ops->get_error(conn->backend_conn);
+            throw error(std::string("Query failed: ") + (err ? err : "unknown error"));
+        }
+        return out;
+    }
+
+    rows<T> all() const { return select(); }
+
+    void save(T& instance) const {
+        if (!corm_save(db_, model<T>::meta(), &instance)) {
+            throw error(corm_get_last_error(db_));
+        }
+    }
+
+    void remove(T& instance) const {
+        model_meta_t* meta = model<T>::meta();
+        if (!meta->primary_key_field) {
+            throw error(std::string("Model ") + meta->table_name + " has no primary key");
+        }
+        void* pk_value = (char*)&instance + meta->primary_key_field->offset;
+        if (!corm_delete(db_, meta, pk_value)) {
+            throw error(corm_get_last_error(db_));
+        }
+    }
+
+private:
+    template <size_t... I>
+    static std::array<const char*, sizeof...(I)> column_names(std::index_sequence<I...>) {
+        constexpr auto cols = model<T>::columns();
+        return { std::get<I>(cols).name... };
+    }
+
+    corm_db_t* db_;
+};
+
+} // namespace corm
+
+#define CORM_HPP_EACH_1(m, t, x) m(t, x)
+#define CORM_HPP_EACH_2(m, t, x, ...) m(t, x), CORM_HPP_EACH_1(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_3(m, t, x, ...) m(t, x), CORM_HPP_EACH_2(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_4(m, t, x, ...) m(t, x), CORM_HPP_EACH_3(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_5(m, t, x, ...) m(t, x), CORM_HPP_EACH_4(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_6(m, t, x, ...) m(t, x), CORM_HPP_EACH_5(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_7(m, t, x, ...) m(t, x), CORM_HPP_EACH_6(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_8(m, t, x, ...) m(t, x), CORM_HPP_EACH_7(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_9(m, t, x, ...) m(t, x), CORM_HPP_EACH_8(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_10(m, t, x, ...) m(t, x), CORM_HPP_EACH_9(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_11(m, t, x, ...) m(t, x), CORM_HPP_EACH_10(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_12(m, t, x, ...) m(t, x), CORM_HPP_EACH_11(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_13(m, t, x, ...) m(t, x), CORM_HPP_EACH_12(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_14(m, t, x, ...) m(t, x), CORM_HPP_EACH_13(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_15(m, t, x, ...) m(t, x), CORM_HPP_EACH_14(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_16(m, t, x, ...) m(t, x), CORM_HPP_EACH_15(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_17(m, t, x, ...) m(t, x), CORM_HPP_EACH_16(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_18(m, t, x, ...) m(t, x), CORM_HPP_EACH_17(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_19(m, t, x, ...) m(t, x), CORM_HPP_EACH_18(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_20(m, t, x, ...) m(t, x), CORM_HPP_EACH_19(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_21(m, t, x, ...) m(t, x), CORM_HPP_EACH_20(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_22(m, t, x, ...) m(t, x), CORM_HPP_EACH_21(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_23(m, t, x, ...) m(t, x), CORM_HPP_EACH_22(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_24(m, t, x, ...) m(t, x), CORM_HPP_EACH_23(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_25(m, t, x, ...) m(t, x), CORM_HPP_EACH_24(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_26(m, t, x, ...) m(t, x), CORM_HPP_EACH_25(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_27(m, t, x, ...) m(t, x), CORM_HPP_EACH_26(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_28(m, t, x, ...) m(t, x), CORM_HPP_EACH_27(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_29(m, t, x, ...) m(t, x), CORM_HPP_EACH_28(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_30(m, t, x, ...) m(t, x), CORM_HPP_EACH_29(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_31(m, t, x, ...) m(t, x), CORM_HPP_EACH_30(m, t, __VA_ARGS__)
+#define CORM_HPP_EACH_32(m, t, x, ...) m(t, x), CORM_HPP_EACH_31(m, t, __VA_ARGS__)
+
+#define CORM_HPP_NARGS_IMPL(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+                            _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, \
+                            _31, _32, N, ...) N
+#define CORM_HPP_NARGS(...) CORM_HPP_NARGS_IMPL(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, \
+                                                22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, \
+                                                9, 8, 7, 6, 5, 4, 3, 2, 1)
+
+#define CORM_HPP_COLUMN(stype, member) ::corm::column<stype, decltype(stype::member)>{#member, &stype::member}
+
+// Up to 32 columns. Put it at global scope, after DEFINE_MODEL(name, stype, ...).
+#define CORM_MODEL(name, stype, ...) \
+    template <> struct corm::model<stype> { \
+        static model_meta_t* meta() noexcept { return &name##_model; } \
+        static constexpr auto columns() noexcept { \
+            return std::make_tuple(_DISPATCH(CORM_HPP_EACH_, CORM_HPP_NARGS(__VA_ARGS__))(CORM_HPP_COLUMN, stype, __VA_ARGS__)); \
+        } \
+    }
+
+#endif // CORM_HPP_
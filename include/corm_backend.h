@@ -8,11 +8,170 @@
 typedef struct corm_db_t corm_db_t;
 typedef struct model_meta_t model_meta_t;
 typedef struct field_info_t field_info_t;
-typedef enum field_type_e field_type_e;
+
+typedef enum field_type_e {
+    FIELD_TYPE_INT,
+    FIELD_TYPE_INT64,
+    FIELD_TYPE_FLOAT,
+    FIELD_TYPE_DOUBLE,
+    FIELD_TYPE_STRING,
+    FIELD_TYPE_BOOL,
+    FIELD_TYPE_BLOB,
+    FIELD_TYPE_BELONGS_TO,
+    FIELD_TYPE_HAS_MANY
+} field_type_e;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef void* corm_backend_conn_t;
 typedef void* corm_backend_stmt_t;
 
+// Results of step (and of fetch_rows before any row is written). BUSY and
+// LOCKED mean another connection holds a lock and the same step may succeed
+// if run again later; backends that can't tell return ERROR.
+#define CORM_STEP_ROW     1
+#define CORM_STEP_DONE    0
+#define CORM_STEP_ERROR  -1
+#define CORM_STEP_BUSY   -2
+#define CORM_STEP_LOCKED -3
+#define CORM_STEP_INTERRUPTED -4  // stopped by the progress handler or interrupt
+
+// Where each column of a row lives in a model instance. For fetch_rows
+// `index` is the result column, for bind_row the parameter index.
+typedef struct {
+    size_t offset;
+    field_type_e type;
+    int index;
+} corm_column_plan_t;
+
+typedef struct {
+    const corm_column_plan_t* columns;
+    size_t count;
+    size_t row_size;
+
+    // fetch_rows copies strings and blobs into memory from here
+    void* (*alloc)(void* ctx, size_t size);
+    void* alloc_ctx;
+} corm_row_plan_t;
+
+// Structured form of the statements corm builds for a model, for backends
+// that would rather not parse SQL (see prepare_request). Values aren't part
+// of a request: parameters are numbered from 1 and bound through the bind_*
+// ops after prepare, so one prepared request serves any values.
+typedef enum {
+    CORM_REQUEST_SELECT,
+    CORM_REQUEST_INSERT,
+    CORM_REQUEST_UPDATE,
+    CORM_REQUEST_DELETE
+} corm_request_op_e;
+
+typedef enum {
+    CORM_PRED_CMP,  // column <cmp> parameter
+    CORM_PRED_AND,
+    CORM_PRED_OR,
+    CORM_PRED_RAW,  // user-written condition, corm's where syntax
+    CORM_PRED_IN    // column IN (count parameters from param on)
+} corm_pred_kind_e;
+
+typedef enum {
+    CORM_CMP_EQ,
+    CORM_CMP_NE,
+    CORM_CMP_LT,
+    CORM_CMP_LE,
+    CORM_CMP_GT,
+    CORM_CMP_GE
+} corm_cmp_e;
+
+typedef struct corm_predicate_t {
+    corm_pred_kind_e kind;
+
+    const char* column; // CMP
+    corm_cmp_e cmp;     // CMP
+    int param;          // CMP: the compared parameter, RAW: the first `?` in sql, IN: the first value
+    int count;          // IN: number of values
+
+    const char* sql;    // RAW, with `?` placeholders numbered on from param; a `?` inside
+                        // '...', "...", `...` or [...] is text, not a placeholder
+
+    const struct corm_predicate_t* left;  // AND / OR
+    const struct corm_predicate_t* right;
+} corm_predicate_t;
+
+typedef struct {
+    const char* name;
+    field_type_e type;
+    bool add; // UPDATE: column = column + parameter
+} corm_request_column_t;
+
+typedef struct {
+    corm_request_op_e op;
+    const char* table;
+    const char* primary_key; // NULL when the model has none
+
+    // SELECT: the result columns in order. INSERT/UPDATE: the columns
+    // written, bound as parameters 1..column_count. Unused for DELETE.
+    const corm_request_column_t* columns;
+    size_t column_count;
+
+    const corm_predicate_t* where; // NULL for every row
+    const char* order_by;          // SQL ORDER BY text as the user gave it, or NULL
+    int limit;                     // -1 for no limit
+    int offset;
+
+    const field_type_e* param_types;
+    size_t param_count;
+
+    // Equal for requests that differ only in their values, a key for plan caches
+    uint64_t shape;
+} corm_request_t;
+
+// Connection tuning, see configure. Zero fields keep the backend's default.
+typedef enum {
+    CORM_JOURNAL_DEFAULT,
+    CORM_JOURNAL_DELETE,
+    CORM_JOURNAL_TRUNCATE,
+    CORM_JOURNAL_PERSIST,
+    CORM_JOURNAL_MEMORY,
+    CORM_JOURNAL_WAL,
+    CORM_JOURNAL_OFF
+} corm_journal_mode_e;
+
+typedef enum {
+    CORM_SYNCHRONOUS_DEFAULT,
+    CORM_SYNCHRONOUS_OFF,
+    CORM_SYNCHRONOUS_NORMAL,
+    CORM_SYNCHRONOUS_FULL,
+    CORM_SYNCHRONOUS_EXTRA
+} corm_synchronous_e;
+
+typedef enum {
+    CORM_TEMP_STORE_DEFAULT,
+    CORM_TEMP_STORE_FILE,
+    CORM_TEMP_STORE_MEMORY
+} corm_temp_store_e;
+
+typedef struct {
+    corm_journal_mode_e journal_mode;
+    corm_synchronous_e synchronous;
+    int64_t mmap_size;       // bytes
+    int64_t cache_size_kib;  // page cache per connection
+    int page_size;           // bytes, only for databases that don't exist yet
+    corm_temp_store_e temp_store;
+    int busy_timeout_ms;
+    int64_t soft_heap_limit; // bytes, process-wide
+
+    // Per-connection lookaside: small-allocation slots SQLite carves out of
+    // one block instead of calling malloc
+    int lookaside_slot_size; // bytes
+    int lookaside_slots;
+
+    // Not passed to the backend: how long corm keeps retrying statements
+    // that come back busy or locked
+    int busy_retry_ms;
+} corm_config_t;
+
 typedef struct corm_backend_ops_t {
     // Backend identification
     const char* name; // "sqlite", "postgres", etc...
@@ -28,6 +187,10 @@ typedef struct corm_backend_ops_t {
     // Prepared statements
     bool (*prepare)(corm_backend_conn_t conn, corm_backend_stmt_t* stmt, 
                     const char* sql, char** error);
+    // Optional. When set, queries, inserts, updates and deletes of models
+    // arrive here as requests instead of SQL text through prepare.
+    bool (*prepare_request)(corm_backend_conn_t conn, corm_backend_stmt_t* stmt,
+                            const corm_request_t* request, char** error);
     void (*finalize)(corm_backend_stmt_t stmt);
     bool (*reset)(corm_backend_stmt_t stmt);
     
@@ -40,7 +203,7 @@ typedef struct corm_backend_ops_t {
     bool (*bind_null)(corm_backend_stmt_t stmt, int index);
     
     // Execution and results
-    int (*step)(corm_backend_stmt_t stmt); // Returns: 1=row, 0=done, -1=error
+    int (*step)(corm_backend_stmt_t stmt); // Returns one of CORM_STEP_*
     int (*column_count)(corm_backend_stmt_t stmt);
     const char* (*column_name)(corm_backend_stmt_t stmt, int index);
     int (*column_type)(corm_backend_stmt_t stmt, int index); // 0=null, 1=int, 2=float, 3=text, 4=blob
@@ -52,9 +215,21 @@ typedef struct corm_backend_ops_t {
     const unsigned char* (*column_text)(corm_backend_stmt_t stmt, int index);
     const void* (*column_blob)(corm_backend_stmt_t stmt, int index);
     int (*column_bytes)(corm_backend_stmt_t stmt, int index);
+
+    // Whole-row access (optional). fetch_rows steps and decodes up to
+    // max_rows rows into consecutive row_size slots of out_buf, which the
+    // caller has zeroed; NULL columns are left alone. Returns the number of
+    // rows written, fewer than max_rows once the statement is done, or a
+    // CORM_STEP_* error code.
+    // bind_row binds every planned field of instance.
+    int (*fetch_rows)(corm_backend_stmt_t stmt, const corm_row_plan_t* plan, void* out_buf, int max_rows);
+    bool (*bind_row)(corm_backend_stmt_t stmt, const corm_row_plan_t* plan, const void* instance);
     
     // Last insert ID
     int64_t (*last_insert_id)(corm_backend_conn_t conn);
+
+    // Rows affected by the last INSERT/UPDATE/DELETE (optional)
+    int64_t (*changes)(corm_backend_conn_t conn);
     
     // Transaction support
     bool (*begin_transaction)(corm_backend_conn_t conn);
@@ -71,11 +246,46 @@ typedef struct corm_backend_ops_t {
     // Database-specific utilities
     bool (*table_exists)(corm_backend_conn_t conn, const char* table_name);
     bool (*set_foreign_keys)(corm_backend_conn_t conn, bool enabled);
+
+    // Read replicas (optional)
+    bool (*enable_wal)(corm_backend_conn_t conn);
+    bool (*set_read_only)(corm_backend_conn_t conn, bool enabled);
+
+    // Stopping long statements (optional). The progress handler runs every
+    // so often while a statement executes on conn; a non-zero return stops
+    // it and step returns CORM_STEP_INTERRUPTED. NULL removes it. interrupt
+    // stops whatever conn is running and may be called from any thread.
+    void (*set_progress)(corm_backend_conn_t conn, int (*handler)(void* ctx), void* ctx);
+    void (*interrupt)(corm_backend_conn_t conn);
+
+    // Connection tuning (optional). Applies the non-zero fields of config.
+    bool (*configure)(corm_backend_conn_t conn, const corm_config_t* config, char** error);
+
+    // Schema catalog (optional). list_tables calls `each` for every table in
+    // the database from a single catalog read. The schema version is a
+    // number kept in the database itself, 0 until set; corm stores a hash
+    // of the registered models there to skip corm_sync when nothing changed.
+    // Keep it somewhere the application doesn't use: set_schema_version runs
+    // inside the sync transaction and may create what it needs.
+    bool (*list_tables)(corm_backend_conn_t conn, void (*each)(void* ctx, const char* name), void* ctx);
+    bool (*get_schema_version)(corm_backend_conn_t conn, uint32_t* version);
+    bool (*set_schema_version)(corm_backend_conn_t conn, uint32_t version);
     
 } corm_backend_ops_t;
 
 // Backend registration - built-in backend(s)
 const corm_backend_ops_t* corm_backend_sqlite_init();
+
+// Routes all of SQLite's own memory (page cache, statements, lookaside)
+// through alloc_fn/free_fn, e.g. the allocator given to corm. Process-wide
+// and only possible before SQLite is first used, so call it before the
+// first corm_init. Both functions are called from any thread.
+bool corm_backend_sqlite_set_allocator(void* ctx, void* (*alloc_fn)(void*, size_t),
+                                       void (*free_fn)(void*, void*));
 // const corm_backend_ops_t* corm_backend_postgresql_init();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // CORM_BACKEND_H_
@@ -0,0 +1,152 @@
+#ifndef CORM_CORO_HPP_
+#define CORM_CORO_HPP_
+
+// C++20 coroutine awaiters over corm's async execution.
+//
+//   corm::result users = co_await corm::query(corm_query(db, &User_model));
+//   co_await corm::save(db, &User_model, &u);
+//   corm::result one = co_await corm::find(db, &User_model, &id);
+//
+// Needs corm_async_enable(db, n) first. The coroutine is resumed on the
+// worker thread that ran the job (CORM_ASYNC_INLINE), so no dispatch loop is
+// involved; hop back to your own executor if the code after co_await cares
+// which thread it runs on. Failures throw corm::error from the co_await;
+// finding or querying nothing isn't one and gives an empty result.
+// Works with any coroutine type, corm doesn't ship one.
+
+#include <coroutine>
+#include <string>
+#include <utility>
+
+#include "corm.hpp"
+
+namespace corm {
+
+namespace detail {
+
+// Shared part of every awaiter. It lives in the awaiting coroutine's frame
+// until the co_await finishes, which is what keeps instances, query
+// parameters and the where clause alive while a worker uses them.
+class async_op {
+protected:
+    explicit async_op(corm_db_t* db) noexcept : db_(db) {}
+
+    static void complete(corm_db_t*, bool ok, corm_result_t* res, const char* err, void* userdata) {
+        async_op* op = static_cast<async_op*>(userdata);
+        op->ok_ = ok;
+        op->res_ = res;
+        if (!ok) op->error_ = err ? err : "unknown error";
+        op->handle_.resume();
+    }
+
+    // `submitted` is the return value of the corm_*_async_ex call. Nothing
+    // may touch *this after a successful submit, the coroutine might
+    // already be running again on a worker.
+    bool suspend_result(bool submitted) {
+        if (!submitted) {
+            ok_ = false;
+            error_ = corm_get_last_error(db_);
+        }
+        return submitted;
+    }
+
+    void check() const {
+        if (!ok_) throw error(error_);
+    }
+
+    corm_db_t* db_;
+    std::coroutine_handle<> handle_;
+    bool ok_ = false;
+    corm_result_t* res_ = nullptr;
+    std::string error_;
+};
+
+} // namespace detail
+
+// Takes ownership of q, like corm_query_exec.
+class query : detail::async_op {
+public:
+    explicit query(corm_query_t* q) noexcept : async_op(q ? q->db : nullptr), q_(q) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+        corm_query_t* q = std::exchange(q_, nullptr);
+        return suspend_result(corm_query_exec_async_ex(q, &async_op::complete, this, CORM_ASYNC_INLINE));
+    }
+
+    result await_resume() {
+        check();
+        return result(db_, res_);
+    }
+
+private:
+    corm_query_t* q_;
+};
+
+// `instance` has to outlive the co_await, as with corm_save_async.
+class save : detail::async_op {
+public:
+    save(corm_db_t* db, model_meta_t* meta, void* instance) noexcept
+        : async_op(db), meta_(meta), instance_(instance) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+        return suspend_result(corm_save_async_ex(db_, meta_, instance_, &async_op::complete, this,
+                                                 CORM_ASYNC_INLINE));
+    }
+
+    void await_resume() { check(); }
+
+private:
+    model_meta_t* meta_;
+    void* instance_;
+};
+
+// Looks a row up by primary key; the result holds the row, or is empty
+// when there is none.
+class find : detail::async_op {
+public:
+    find(corm_db_t* db, model_meta_t* meta, void* pk_value) noexcept
+        : async_op(db), meta_(meta), pk_value_(pk_value) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+
+        field_info_t* pk = meta_->primary_key_field;
+        if (!pk) {
+            ok_ = false;
+            error_ = std::string("Model ") + meta_->table_name + " has no primary key";
+            return false;
+        }
+
+        corm_query_t* q = corm_query(db_, meta_);
+        if (!q) return suspend_result(false);
+
+        clause_ = std::string(pk->name) + " = ?";
+        type_ = pk->type;
+        corm_query_where(q, clause_.c_str(), &pk_value_, &type_, 1);
+        corm_query_limit(q, 1);
+        return suspend_result(corm_query_exec_async_ex(q, &async_op::complete, this, CORM_ASYNC_INLINE));
+    }
+
+    result await_resume() {
+        check();
+        return result(db_, res_);
+    }
+
+private:
+    model_meta_t* meta_;
+    void* pk_value_;
+    std::string clause_;
+    field_type_e type_ = FIELD_TYPE_INT;
+};
+
+} // namespace corm
+
+#endif // CORM_CORO_HPP_
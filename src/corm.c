@@ -3,9 +3,33 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 #define CORM_SET_ERROR(db, fmt, ...) \
-    snprintf((db)->last_error, sizeof((db)->last_error), fmt, ##__VA_ARGS__)
+    CORM_SET_ERROR_CODE(db, CORM_ERROR_GENERIC, fmt, ##__VA_ARGS__)
+
+#define CORM_SET_ERROR_CODE(db, code, fmt, ...) \
+    ((db)->last_error_code = (code), \
+     snprintf((db)->last_error, sizeof((db)->last_error), fmt, ##__VA_ARGS__))
+
+// Hot backend calls (binding, stepping, reading columns) go through CORM_BE.
+// Normally that's the ops table; the CORM_STATIC_BACKEND=sqlite unity build
+// (src/corm_static_sqlite.c) compiles the SQLite backend into this file and
+// calls its functions directly so the compiler can inline them.
+#ifdef CORM_STATIC_BACKEND_SQLITE
+#define CORM_BE(db, op) ((void)(db), sqlite_##op)
+#else
+#define CORM_BE(db, op) ((db)->backend->op)
+#endif
 
 #define CORM_KIB(n) ((uint64_t)(n) << 10)
 #define CORM_MIB(n) ((uint64_t)(n) << 20)
@@ -156,8 +180,15 @@ static inline corm_result_t* corm_result_create(corm_db_t* db, model_meta_t* met
     result->data = NULL;
     result->count = 0;
     result->meta = meta;
+    result->snapshot = NULL;
+    result->prev_tracked = NULL;
+    result->next_tracked = NULL;
     result->allocation_capacity = 16;
     result->allocation_count = 0;
+    result->capacity = 0;
+    result->chunk = NULL;
+    result->chunk_used = 0;
+    result->chunk_size = 0;
     result->allocations = corm_alloc_fn(db, sizeof(void*) * result->allocation_capacity);
     
     if (!result->allocations) {
@@ -186,15 +217,628 @@ static inline bool corm_result_track(corm_db_t* db, corm_result_t* result, void*
     return true;
 }
 
+// Strings and blobs of a result are carved out of chunks that double in
+// size, so a result costs a handful of allocations however many rows it has
+#define CORM_RESULT_CHUNK_MIN 256
+
 static inline void* corm_result_alloc(corm_db_t* db, corm_result_t* result, size_t size) {
-    void* ptr = corm_alloc_fn(db, size);
-    if (ptr) {
-        if (!corm_result_track(db, result, ptr)) {
-            corm_free_fn(db, ptr);
-            return NULL;
+    size_t used = CORM_ALIGN_UP(result->chunk_used, CORM_ARENA_DEFAULT_ALIGN);
+    if (result->chunk && used + size <= result->chunk_size) {
+        result->chunk_used = used + size;
+        return result->chunk + used;
+    }
+
+    size_t chunk_size = result->chunk_size ? result->chunk_size * 2 : CORM_RESULT_CHUNK_MIN;
+    if (chunk_size < size) chunk_size = size;
+
+    char* chunk = corm_alloc_fn(db, chunk_size);
+    if (!chunk) return NULL;
+    if (!corm_result_track(db, result, chunk)) {
+        corm_free_fn(db, chunk);
+        return NULL;
+    }
+    result->chunk = chunk;
+    result->chunk_size = chunk_size;
+    result->chunk_used = size;
+    return chunk;
+}
+
+#define CORM_FNV_OFFSET 0xcbf29ce484222325ULL
+#define CORM_FNV_PRIME  0x100000001b3ULL
+
+static inline uint64_t corm_hash_bytes(uint64_t h, const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= CORM_FNV_PRIME;
+    }
+    return h;
+}
+
+static inline bool corm_is_column(const field_info_t* field) {
+    return field->type != FIELD_TYPE_BELONGS_TO && field->type != FIELD_TYPE_HAS_MANY;
+}
+
+// Model registry
+//
+// Models are kept in registration order in db->models, which doubles when
+// it fills up, and indexed by table name in an open addressing table. A
+// second table indexes fields by (model, name). Both keep at most half of
+// their slots used and are rebuilt at twice the size past that, so looking
+// up a model or a field costs the same with 10 models or 10,000. Like
+// db->models, the tables come from the handle's allocator.
+typedef struct {
+    model_meta_t* meta;
+    field_info_t* field;
+} corm_field_slot_t;
+
+struct corm_registry_t {
+    model_meta_t** models;
+    size_t model_slots;
+
+    corm_field_slot_t* fields;
+    size_t field_slots;
+    size_t field_count;
+};
+
+static inline uint64_t corm_field_hash(model_meta_t* meta, const char* name) {
+    uint64_t h = corm_hash_bytes(CORM_FNV_OFFSET, &meta, sizeof(meta));
+    return corm_hash_bytes(h, name, strlen(name));
+}
+
+static inline size_t corm_slots_for(size_t count) {
+    size_t slots = 16;
+    while (slots < count * 2) slots <<= 1;
+    return slots;
+}
+
+static void corm_registry_put_model(corm_registry_t* reg, model_meta_t* meta) {
+    size_t mask = reg->model_slots - 1;
+    size_t slot = corm_hash_bytes(CORM_FNV_OFFSET, meta->table_name, strlen(meta->table_name)) & mask;
+    while (reg->models[slot]) slot = (slot + 1) & mask;
+    reg->models[slot] = meta;
+}
+
+static void corm_registry_put_field(corm_registry_t* reg, model_meta_t* meta, field_info_t* field) {
+    size_t mask = reg->field_slots - 1;
+    size_t slot = corm_field_hash(meta, field->name) & mask;
+    while (reg->fields[slot].meta) slot = (slot + 1) & mask;
+    reg->fields[slot] = (corm_field_slot_t){ meta, field };
+}
+
+// Makes room for `models` models and `fields` fields in total
+static bool corm_registry_reserve(corm_db_t* db, corm_registry_t* reg, size_t models, size_t fields) {
+    if (models * 2 > reg->model_slots) {
+        size_t slots = corm_slots_for(models);
+        model_meta_t** table = corm_alloc_fn(db, sizeof(model_meta_t*) * slots);
+        if (!table) return false;
+        memset(table, 0, sizeof(model_meta_t*) * slots);
+
+        model_meta_t** old = reg->models;
+        size_t old_slots = reg->model_slots;
+        reg->models = table;
+        reg->model_slots = slots;
+        for (size_t i = 0; i < old_slots; i++) {
+            if (old[i]) corm_registry_put_model(reg, old[i]);
         }
+        corm_free_fn(db, old);
     }
-    return ptr;
+
+    if (fields * 2 > reg->field_slots) {
+        size_t slots = corm_slots_for(fields);
+        corm_field_slot_t* table = corm_alloc_fn(db, sizeof(corm_field_slot_t) * slots);
+        if (!table) return false;
+        memset(table, 0, sizeof(corm_field_slot_t) * slots);
+
+        corm_field_slot_t* old = reg->fields;
+        size_t old_slots = reg->field_slots;
+        reg->fields = table;
+        reg->field_slots = slots;
+        for (size_t i = 0; i < old_slots; i++) {
+            if (old[i].meta) corm_registry_put_field(reg, old[i].meta, old[i].field);
+        }
+        corm_free_fn(db, old);
+    }
+    return true;
+}
+
+static void corm_registry_free(corm_db_t* db, corm_registry_t* reg) {
+    corm_free_fn(db, reg->models);
+    corm_free_fn(db, reg->fields);
+    corm_free_fn(db, reg);
+}
+
+static void corm_registry_destroy(corm_db_t* db) {
+    if (!db->registry) return;
+    corm_registry_free(db, db->registry);
+    db->registry = NULL;
+}
+
+// Copies reg into memory from db's current allocator, slot for slot
+static corm_registry_t* corm_registry_copy(corm_db_t* db, const corm_registry_t* reg) {
+    corm_registry_t* copy = corm_alloc_fn(db, sizeof(corm_registry_t));
+    if (!copy) return NULL;
+    *copy = (corm_registry_t){ .model_slots = reg->model_slots, .field_slots = reg->field_slots,
+                               .field_count = reg->field_count };
+
+    size_t models_size = sizeof(model_meta_t*) * reg->model_slots;
+    size_t fields_size = sizeof(corm_field_slot_t) * reg->field_slots;
+    if ((models_size && !(copy->models = corm_alloc_fn(db, models_size))) ||
+        (fields_size && !(copy->fields = corm_alloc_fn(db, fields_size)))) {
+        corm_registry_free(db, copy);
+        return NULL;
+    }
+    if (models_size) memcpy(copy->models, reg->models, models_size);
+    if (fields_size) memcpy(copy->fields, reg->fields, fields_size);
+    return copy;
+}
+
+static model_meta_t* corm_find_model(corm_db_t* db, const char* table_name) {
+    corm_registry_t* reg = db->registry;
+    if (!reg) return NULL;
+
+    size_t mask = reg->model_slots - 1;
+    size_t slot = corm_hash_bytes(CORM_FNV_OFFSET, table_name, strlen(table_name)) & mask;
+    while (reg->models[slot]) {
+        if (strcmp(reg->models[slot]->table_name, table_name) == 0) return reg->models[slot];
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// Fields of models that were never registered on db are searched one by one
+static field_info_t* corm_field_by_name(corm_db_t* db, model_meta_t* meta, const char* name) {
+    corm_registry_t* reg = db->registry;
+    if (reg) {
+        size_t mask = reg->field_slots - 1;
+        size_t slot = corm_field_hash(meta, name) & mask;
+        while (reg->fields[slot].meta) {
+            corm_field_slot_t* e = &reg->fields[slot];
+            if (e->meta == meta && strcmp(e->field->name, name) == 0) return e->field;
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (strcmp(meta->fields[i].name, name) == 0) {
+            return &meta->fields[i];
+        }
+    }
+    return NULL;
+}
+
+// Appends meta to db->models and the registry
+static bool corm_add_model(corm_db_t* db, model_meta_t* meta) {
+    if (!db->registry) {
+        db->registry = corm_alloc_fn(db, sizeof(corm_registry_t));
+        if (!db->registry) {
+            CORM_SET_ERROR(db, "Failed to allocate the model registry");
+            return false;
+        }
+        memset(db->registry, 0, sizeof(corm_registry_t));
+    }
+
+    corm_registry_t* reg = db->registry;
+    if (!corm_registry_reserve(db, reg, db->model_count + 1, reg->field_count + meta->field_count)) {
+        CORM_SET_ERROR(db, "Failed to grow the model registry");
+        return false;
+    }
+
+    if (db->model_count == db->model_capacity) {
+        size_t capacity = db->model_capacity * 2;
+        model_meta_t** models = corm_alloc_fn(db, sizeof(model_meta_t*) * capacity);
+        if (!models) {
+            CORM_SET_ERROR(db, "Failed to grow the model table");
+            return false;
+        }
+        memcpy(models, db->models, sizeof(model_meta_t*) * db->model_count);
+        corm_free_fn(db, db->models);
+        db->models = models;
+        db->model_capacity = capacity;
+    }
+
+    corm_registry_put_model(reg, meta);
+    for (size_t i = 0; i < meta->field_count; i++) {
+        corm_registry_put_field(reg, meta, &meta->fields[i]);
+    }
+    reg->field_count += meta->field_count;
+    db->models[db->model_count++] = meta;
+    return true;
+}
+
+// Statement cache
+//
+// Statements whose SQL only depends on the model and a small key (a field
+// mask, a field index...) are prepared once and reused. Queries are keyed by
+// their request shape, a hash over text that comes from the user, so their
+// entries also keep the bytes the shape was hashed from and a hit has to
+// match those too. Entries live in an open addressing table; once it holds
+// CORM_STMT_CACHE_CAPACITY statements, a clock sweep finalizes one that
+// hasn't been used since the hand last passed it. Statements lent out by
+// corm_select_prepare are never evicted and look like a miss to everyone
+// else until they come back.
+typedef enum {
+    CORM_STMT_UPDATE = 1,
+    CORM_STMT_UPDATE_IF,
+    CORM_STMT_INCREMENT,
+    CORM_STMT_DELETE_MANY,
+    CORM_STMT_QUERY,       // keyed by request shape, with the shape's text
+    CORM_STMT_EXISTS,
+    CORM_STMT_INSERT,
+    CORM_STMT_SAVE_UPDATE, // whole row, models too wide for a mask
+} corm_stmt_kind_e;
+
+// Keys per DELETE ... IN (...) statement, well under every backend's
+// parameter limit
+#define CORM_DELETE_MANY_CHUNK 256
+
+// Statements corm_select_prepare can lend out at once per connection; past
+// that it hands out statements of their own
+#define CORM_STMT_LENT_MAX 8
+
+typedef struct {
+    model_meta_t* meta;
+    int kind;
+    uint64_t key;
+    corm_backend_stmt_t stmt;
+    uint8_t* text;      // CORM_STMT_QUERY: the shape's bytes, owned by the entry
+    uint64_t text_size;
+    size_t home;        // slot the key hashes to
+    bool referenced;    // hit since the clock hand last passed
+    bool lent;          // held by a corm_select_prepare caller
+} corm_stmt_entry_t;
+
+typedef struct {
+    model_meta_t* meta;
+    int kind;
+    uint64_t key;
+    corm_backend_stmt_t stmt;
+} corm_stmt_lent_t;
+
+struct corm_stmt_cache_t {
+    corm_stmt_entry_t* entries;
+    size_t capacity;
+    size_t count;
+    size_t hand;
+
+    corm_stmt_lent_t lent[CORM_STMT_LENT_MAX];
+    size_t lent_count;
+};
+
+static inline size_t corm_stmt_slot(corm_stmt_cache_t* cache, model_meta_t* meta, int kind, uint64_t key) {
+    uint64_t h = CORM_FNV_OFFSET;
+    h = corm_hash_bytes(h, &meta, sizeof(meta));
+    h = corm_hash_bytes(h, &kind, sizeof(kind));
+    h = corm_hash_bytes(h, &key, sizeof(key));
+    return (size_t)(h & (cache->capacity - 1));
+}
+
+static inline bool corm_stmt_entry_matches(const corm_stmt_entry_t* e, model_meta_t* meta, int kind,
+                                           uint64_t key, const corm_string_t* text) {
+    if (e->meta != meta || e->kind != kind || e->key != key) return false;
+    if (!text) return e->text == NULL;
+    return e->text && e->text_size == text->size && memcmp(e->text, text->str, text->size) == 0;
+}
+
+static corm_stmt_entry_t* corm_stmt_cache_find(corm_stmt_cache_t* cache, model_meta_t* meta, int kind,
+                                               uint64_t key, const corm_string_t* text) {
+    size_t slot = corm_stmt_slot(cache, meta, kind, key);
+    while (cache->entries[slot].stmt) {
+        corm_stmt_entry_t* e = &cache->entries[slot];
+        if (corm_stmt_entry_matches(e, meta, kind, key, text)) {
+            return e;
+        }
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+    return NULL;
+}
+
+static void corm_stmt_cache_insert(corm_stmt_cache_t* cache, const corm_stmt_entry_t* entry) {
+    size_t slot = entry->home;
+    while (cache->entries[slot].stmt) {
+        slot = (slot + 1) & (cache->capacity - 1);
+    }
+    cache->entries[slot] = *entry;
+    cache->count++;
+}
+
+// Empties a slot and pulls later entries of the probe chain back into it,
+// so lookups never stop early at the hole
+static void corm_stmt_cache_remove(corm_stmt_cache_t* cache, size_t slot) {
+    size_t mask = cache->capacity - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; cache->entries[next].stmt; next = (next + 1) & mask) {
+        // The entry can fill the hole if the hole lies between its home and where it sits
+        if (((next - cache->entries[next].home) & mask) >= ((next - hole) & mask)) {
+            cache->entries[hole] = cache->entries[next];
+            hole = next;
+        }
+    }
+    memset(&cache->entries[hole], 0, sizeof(corm_stmt_entry_t));
+    cache->count--;
+}
+
+static void corm_stmt_entry_free(corm_db_t* db, corm_stmt_entry_t* e) {
+    db->backend->finalize(e->stmt);
+    if (e->text) corm_free_fn(db, e->text);
+}
+
+// Finalizes one statement that nobody used since the hand last came by
+static void corm_stmt_cache_evict(corm_db_t* db) {
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    for (size_t swept = 0; swept < cache->capacity * 2; swept++) {
+        size_t slot = cache->hand;
+        cache->hand = (cache->hand + 1) & (cache->capacity - 1);
+
+        corm_stmt_entry_t* e = &cache->entries[slot];
+        if (!e->stmt || e->lent) continue;
+        if (e->referenced) {
+            e->referenced = false;
+            continue;
+        }
+        corm_stmt_entry_free(db, e);
+        corm_stmt_cache_remove(cache, slot);
+        return;
+    }
+}
+
+// Finalizes everything but the statements lent out, which are put back
+// into the emptied table
+static void corm_stmt_cache_clear(corm_db_t* db) {
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    if (!cache) return;
+
+    corm_stmt_entry_t kept[CORM_STMT_LENT_MAX];
+    size_t kept_count = 0;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        corm_stmt_entry_t* e = &cache->entries[i];
+        if (!e->stmt) continue;
+        if (e->lent && kept_count < CORM_STMT_LENT_MAX) {
+            kept[kept_count++] = *e;
+        } else {
+            corm_stmt_entry_free(db, e);
+        }
+    }
+    memset(cache->entries, 0, sizeof(corm_stmt_entry_t) * cache->capacity);
+    cache->count = 0;
+
+    for (size_t i = 0; i < kept_count; i++) {
+        corm_stmt_cache_insert(cache, &kept[i]);
+    }
+}
+
+static void corm_stmt_cache_destroy(corm_db_t* db) {
+    if (!db->stmt_cache) return;
+    // Nothing can still be holding a statement once the connection goes
+    for (size_t i = 0; i < db->stmt_cache->capacity; i++) {
+        db->stmt_cache->entries[i].lent = false;
+    }
+    db->stmt_cache->lent_count = 0;
+    corm_stmt_cache_clear(db);
+    corm_free_fn(db, db->stmt_cache->entries);
+    corm_free_fn(db, db->stmt_cache);
+    db->stmt_cache = NULL;
+}
+
+// `text` is the shape's bytes for CORM_STMT_QUERY, NULL for the other kinds.
+// A statement lent out by corm_select_prepare counts as a miss; the caller
+// then prepares its own, which corm_stmt_cache_put won't take.
+static corm_backend_stmt_t corm_stmt_cache_get(corm_db_t* db, model_meta_t* meta, int kind, uint64_t key,
+                                               const corm_string_t* text) {
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    if (!cache) return NULL;
+
+    corm_stmt_entry_t* e = corm_stmt_cache_find(cache, meta, kind, key, text);
+    if (!e || e->lent) return NULL;
+    e->referenced = true;
+    return e->stmt;
+}
+
+static bool corm_stmt_cache_put(corm_db_t* db, model_meta_t* meta, int kind, uint64_t key,
+                                const corm_string_t* text, corm_backend_stmt_t stmt) {
+    if (!db->stmt_cache) {
+        corm_stmt_cache_t* cache = corm_alloc_fn(db, sizeof(corm_stmt_cache_t));
+        if (!cache) return false;
+        // Twice the entry limit keeps the probe chains short
+        size_t capacity = 16;
+        while (capacity < CORM_STMT_CACHE_CAPACITY * 2) capacity <<= 1;
+        cache->entries = corm_alloc_fn(db, sizeof(corm_stmt_entry_t) * capacity);
+        if (!cache->entries) {
+            corm_free_fn(db, cache);
+            return false;
+        }
+        memset(cache->entries, 0, sizeof(corm_stmt_entry_t) * capacity);
+        cache->capacity = capacity;
+        cache->count = 0;
+        cache->hand = 0;
+        cache->lent_count = 0;
+        db->stmt_cache = cache;
+    }
+
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    if (corm_stmt_cache_find(cache, meta, kind, key, text)) {
+        return false;
+    }
+
+    corm_stmt_entry_t entry = { meta, kind, key, stmt, NULL, 0, corm_stmt_slot(cache, meta, kind, key), false, false };
+    if (text) {
+        entry.text = corm_alloc_fn(db, text->size ? text->size : 1);
+        if (!entry.text) return false;
+        memcpy(entry.text, text->str, text->size);
+        entry.text_size = text->size;
+    }
+
+    if (cache->count >= CORM_STMT_CACHE_CAPACITY) {
+        corm_stmt_cache_evict(db);
+    }
+    corm_stmt_cache_insert(cache, &entry);
+    return true;
+}
+
+static inline bool corm_stmt_cache_can_lend(corm_db_t* db) {
+    return !db->stmt_cache || db->stmt_cache->lent_count < CORM_STMT_LENT_MAX;
+}
+
+// Marks a cached statement as held by a corm_select_prepare caller, so
+// nothing else binds, steps or finalizes it until corm_stmt_cache_return
+static bool corm_stmt_cache_lend(corm_db_t* db, model_meta_t* meta, int kind, uint64_t key,
+                                 const corm_string_t* text) {
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    if (!cache || cache->lent_count >= CORM_STMT_LENT_MAX) return false;
+
+    corm_stmt_entry_t* e = corm_stmt_cache_find(cache, meta, kind, key, text);
+    if (!e || e->lent) return false;
+
+    e->lent = true;
+    e->referenced = true;
+    cache->lent[cache->lent_count++] = (corm_stmt_lent_t){ meta, kind, key, e->stmt };
+    return true;
+}
+
+// False when stmt wasn't lent out by the cache, the caller owns it then
+static bool corm_stmt_cache_return(corm_db_t* db, corm_backend_stmt_t stmt) {
+    corm_stmt_cache_t* cache = db->stmt_cache;
+    if (!cache) return false;
+
+    for (size_t i = 0; i < cache->lent_count; i++) {
+        corm_stmt_lent_t* l = &cache->lent[i];
+        if (l->stmt != stmt) continue;
+
+        // Entries sharing a key sit on the same probe chain
+        size_t slot = corm_stmt_slot(cache, l->meta, l->kind, l->key);
+        while (cache->entries[slot].stmt) {
+            if (cache->entries[slot].stmt == stmt) {
+                cache->entries[slot].lent = false;
+                break;
+            }
+            slot = (slot + 1) & (cache->capacity - 1);
+        }
+        cache->lent[i] = cache->lent[--cache->lent_count];
+        return true;
+    }
+    return false;
+}
+
+// Finalizes a statement that didn't make it into the cache, resets one that did
+static inline void corm_stmt_release(corm_db_t* db, corm_backend_stmt_t stmt, bool cached) {
+    if (cached) {
+        CORM_BE(db, reset)(stmt);
+    } else {
+        db->backend->finalize(stmt);
+    }
+}
+
+// Change tracking
+//
+// Scalars are stored verbatim, strings and blobs as a 64-bit hash of their
+// contents. That is enough to tell whether a field was touched since the row
+// was loaded without keeping a copy of every TEXT/BLOB around.
+#define CORM_NULL_FINGERPRINT 0x9e3779b97f4a7c15ULL
+
+static uint64_t corm_field_fingerprint(const void* field_ptr, field_type_e type) {
+    switch (type) {
+        case FIELD_TYPE_INT:
+            return (uint64_t)(uint32_t)*(const int*)field_ptr;
+        case FIELD_TYPE_BOOL:
+            return *(const bool*)field_ptr ? 1 : 0;
+        case FIELD_TYPE_INT64:
+            return (uint64_t)*(const int64_t*)field_ptr;
+        case FIELD_TYPE_FLOAT: {
+            uint32_t bits;
+            memcpy(&bits, field_ptr, sizeof(bits));
+            return bits;
+        }
+        case FIELD_TYPE_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, field_ptr, sizeof(bits));
+            return bits;
+        }
+        case FIELD_TYPE_STRING: {
+            const char* str = *(char* const*)field_ptr;
+            if (!str) return CORM_NULL_FINGERPRINT;
+            return corm_hash_bytes(CORM_FNV_OFFSET, str, strlen(str));
+        }
+        case FIELD_TYPE_BLOB: {
+            const blob_t* blob = (const blob_t*)field_ptr;
+            if (!blob->data || blob->size == 0) return CORM_NULL_FINGERPRINT;
+            uint64_t h = corm_hash_bytes(CORM_FNV_OFFSET, &blob->size, sizeof(blob->size));
+            return corm_hash_bytes(h, blob->data, blob->size);
+        }
+        default:
+            return 0;
+    }
+}
+
+static void corm_snapshot_row(model_meta_t* meta, const void* instance, uint64_t* row_snapshot) {
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        if (!corm_is_column(field)) {
+            row_snapshot[i] = 0;
+            continue;
+        }
+        row_snapshot[i] = corm_field_fingerprint((const char*)instance + field->offset, field->type);
+    }
+}
+
+static void corm_track_result(corm_db_t* db, corm_result_t* result) {
+    result->prev_tracked = NULL;
+    result->next_tracked = db->tracked_results;
+    if (db->tracked_results) {
+        db->tracked_results->prev_tracked = result;
+    }
+    db->tracked_results = result;
+}
+
+static void corm_untrack_result(corm_db_t* db, corm_result_t* result) {
+    if (result->prev_tracked) {
+        result->prev_tracked->next_tracked = result->next_tracked;
+    } else if (db->tracked_results == result) {
+        db->tracked_results = result->next_tracked;
+    }
+    if (result->next_tracked) {
+        result->next_tracked->prev_tracked = result->prev_tracked;
+    }
+    result->prev_tracked = NULL;
+    result->next_tracked = NULL;
+}
+
+// Returns the snapshot of the row `instance` points at, if it was loaded by a
+// tracking query that is still alive.
+static uint64_t* corm_find_snapshot(corm_db_t* db, model_meta_t* meta, void* instance) {
+    for (corm_result_t* r = db->tracked_results; r; r = r->next_tracked) {
+        if (r->meta != meta || !r->data) continue;
+
+        char* begin = (char*)r->data;
+        char* end = begin + (size_t)r->count * meta->struct_size;
+        char* p = (char*)instance;
+        if (p < begin || p >= end) continue;
+
+        size_t offset = (size_t)(p - begin);
+        if (offset % meta->struct_size != 0) return NULL;
+        return r->snapshot + (offset / meta->struct_size) * meta->field_count;
+    }
+    return NULL;
+}
+
+static void corm_snapshot_fields(model_meta_t* meta, const void* instance, uint64_t* row_snapshot, uint64_t mask) {
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (!(mask & (1ULL << i))) continue;
+        field_info_t* field = &meta->fields[i];
+        row_snapshot[i] = corm_field_fingerprint((const char*)instance + field->offset, field->type);
+    }
+}
+
+static uint64_t corm_dirty_mask(model_meta_t* meta, const void* instance, const uint64_t* row_snapshot) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        if (!corm_is_column(field)) continue;
+        uint64_t fp = corm_field_fingerprint((const char*)instance + field->offset, field->type);
+        if (fp != row_snapshot[i]) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
 }
 
 corm_db_t* corm_init(const char* db_filepath) {
@@ -222,6 +866,13 @@ corm_db_t* corm_init_with_backend_and_allocator(const corm_backend_ops_t* backen
         return NULL;
     }
 
+#ifdef CORM_STATIC_BACKEND_SQLITE
+    // Hot paths call the SQLite functions directly in this build
+    if (backend != &sqlite_ops) {
+        return NULL;
+    }
+#endif
+
     corm_db_t* db = CORM_MALLOC(sizeof(corm_db_t));
     if (db == NULL) {
         return NULL;
@@ -238,12 +889,37 @@ corm_db_t* corm_init_with_backend_and_allocator(const corm_backend_ops_t* backen
         return NULL;
     }
     
+    // Kept so extra connections to the same database can be opened later
+    size_t conn_len = connection_string ? strlen(connection_string) : 0;
+    db->connection_string = CORM_MALLOC(conn_len + 1);
+    if (db->connection_string == NULL) {
+        corm_arena_destroy(db->internal_arena);
+        CORM_FREE(db);
+        return NULL;
+    }
+    if (conn_len > 0) memcpy(db->connection_string, connection_string, conn_len);
+    db->connection_string[conn_len] = 0;
+
     db->model_count = 0;
     db->model_capacity = CORM_MAX_MODELS;
+    db->stmt_cache = NULL;
+    db->tracked_results = NULL;
+    db->write_buffer = NULL;
+    db->shared = NULL;
+    db->parent = NULL;
+    db->readers = NULL;
+    db->async = NULL;
+    db->has_config = false;
+    db->size_classes = NULL;
+    db->registry = NULL;
+    db->synced = false;
+    memset(&db->stats, 0, sizeof(db->stats));
 	memset(db->last_error, 0, sizeof(db->last_error));
+    db->last_error_code = CORM_ERROR_NONE;
     
     db->models = corm_alloc_fn(db, sizeof(model_meta_t*) * CORM_MAX_MODELS);
     if (db->models == NULL) {
+        CORM_FREE(db->connection_string);
         corm_arena_destroy(db->internal_arena);
         CORM_FREE(db);
         return NULL;
@@ -255,6 +931,7 @@ corm_db_t* corm_init_with_backend_and_allocator(const corm_backend_ops_t* backen
         CORM_SET_ERROR(db, "Cannot connect to database: %s", error ? error : "unknown error");
         if (error) free(error);
         corm_free_fn(db, db->models);
+        CORM_FREE(db->connection_string);
         corm_arena_destroy(db->internal_arena);
         CORM_FREE(db);
         return NULL;
@@ -263,944 +940,4621 @@ corm_db_t* corm_init_with_backend_and_allocator(const corm_backend_ops_t* backen
     return db;
 }
 
-void corm_set_allocator(corm_db_t* db, void* ctx,
-                        void* (*alloc_fn)(void*, size_t),
-                        void (*free_fn)(void*, void*)) {
-
-    db->allocator.ctx = ctx;
-    db->allocator.alloc_fn = alloc_fn;
-    db->allocator.free_fn = free_fn;
+// True when db names a database no other connection can see (":memory:",
+// a temporary one, or SQLite's mode=memory without a shared cache). Another
+// connection to it opens an empty database.
+static bool corm_private_database(corm_db_t* db) {
+    const char* conn = db->connection_string;
+    if (conn[0] == 0 || strcmp(conn, ":memory:") == 0) return true;
+    if (strncmp(conn, "file:", 5) != 0 || strstr(conn, "cache=shared")) return false;
+    return strncmp(conn, "file::memory:", 13) == 0 || strstr(conn, "mode=memory") != NULL;
 }
 
-void corm_close(corm_db_t* db) {
-    if (!db) return;
-    db->backend->disconnect(db->backend_conn);
-    corm_arena_destroy(db->internal_arena);
-    corm_free_fn(db, db->models);
-    CORM_FREE(db);
-}
+// Opens another connection to the same database, with its own arena,
+// statement cache and error buffer. The registered models are shared, so
+// this should only happen after corm_sync. Errors are reported on `db`.
+static corm_db_t* corm_open_sibling(corm_db_t* db) {
+    if (corm_private_database(db)) {
+        CORM_SET_ERROR(db, "Another connection to '%s' would see an empty database", db->connection_string);
+        return NULL;
+    }
 
-const char* corm_get_last_error(corm_db_t* db) {
-    if (!db) return "Invalid database handle";
-    return db->last_error;
-}
+    corm_db_t* sibling = corm_init_with_backend_and_allocator(db->backend, db->connection_string,
+                                                              db->allocator.ctx,
+                                                              db->allocator.alloc_fn,
+                                                              db->allocator.free_fn);
+    if (!sibling) {
+        CORM_SET_ERROR(db, "Failed to open another connection to '%s'", db->connection_string);
+        return NULL;
+    }
 
-bool corm_register_model(corm_db_t* db, model_meta_t* meta) {
-    field_info_t* pk_field = NULL;
-    int pk_count = 0;
-    
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        if (meta->fields[i].flags & PRIMARY_KEY) {
-            pk_field = &meta->fields[i];
-            pk_count++;
+    if (db->has_config && !corm_configure(sibling, &db->config)) {
+        CORM_SET_ERROR(db, "%s", sibling->last_error);
+        corm_close(sibling);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < db->model_count; i++) {
+        if (!corm_add_model(sibling, db->models[i])) {
+            CORM_SET_ERROR(db, "%s", sibling->last_error);
+            corm_close(sibling);
+            return NULL;
         }
     }
-    
-    if (pk_count == 0) {
-        CORM_SET_ERROR(db, "Model '%s' must have exactly one PRIMARY_KEY field", meta->table_name);
-        return false;
+    return sibling;
+}
+
+bool corm_config_preset(const char* name, corm_config_t* config) {
+    memset(config, 0, sizeof(*config));
+
+    if (strcmp(name, "durable") == 0) {
+        // Every commit survives power loss
+        config->journal_mode    = CORM_JOURNAL_WAL;
+        config->synchronous     = CORM_SYNCHRONOUS_FULL;
+        config->busy_timeout_ms = 5000;
+        return true;
+    }
+    if (strcmp(name, "throughput") == 0) {
+        // A power cut can lose the last commits, never the database
+        config->journal_mode    = CORM_JOURNAL_WAL;
+        config->synchronous     = CORM_SYNCHRONOUS_NORMAL;
+        config->mmap_size       = 256LL << 20;
+        config->cache_size_kib  = 64 << 10;
+        config->temp_store      = CORM_TEMP_STORE_MEMORY;
+        config->busy_timeout_ms = 5000;
+        return true;
+    }
+    if (strcmp(name, "bulk-load") == 0) {
+        // Rollback still works, a crash mid-load can corrupt the file
+        config->journal_mode    = CORM_JOURNAL_MEMORY;
+        config->synchronous     = CORM_SYNCHRONOUS_OFF;
+        config->cache_size_kib  = 256 << 10;
+        config->temp_store      = CORM_TEMP_STORE_MEMORY;
+        return true;
+    }
+    return false;
+}
+
+bool corm_configure(corm_db_t* db, const corm_config_t* config) {
+    if (!db || !config) return false;
+    if (!db->backend->configure) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't support configuration", db->backend->name);
+        return false;
+    }
+
+    char* error = NULL;
+    if (!db->backend->configure(db->backend_conn, config, &error)) {
+        CORM_SET_ERROR(db, "Failed to configure connection: %s", error ? error : "unknown error");
+        if (error) free(error);
+        return false;
+    }
+
+    db->config = *config;
+    db->has_config = true;
+    return true;
+}
+
+corm_db_t* corm_init_with_config(const char* db_filepath, const corm_config_t* config) {
+    corm_db_t* db = corm_init(db_filepath);
+    if (!db) return NULL;
+
+    if (!corm_configure(db, config)) {
+        corm_close(db);
+        return NULL;
+    }
+    return db;
+}
+
+bool corm_enable_readers(corm_db_t* db, size_t readers) {
+    if (db->readers) {
+        CORM_SET_ERROR(db, "Read-only connections are already open");
+        return false;
+    }
+    if (corm_private_database(db)) {
+        CORM_SET_ERROR(db, "Read-only connections need a database file, '%s' can't be shared",
+                       db->connection_string);
+        return false;
+    }
+    if (!db->backend->enable_wal || !db->backend->set_read_only) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't support read-only connections", db->backend->name);
+        return false;
+    }
+
+    // Readers only stay out of the writer's way with a write-ahead log
+    if (!db->backend->enable_wal(db->backend_conn)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to enable WAL: %s", backend_err ? backend_err : "unknown error");
+        return false;
+    }
+
+    // Readers are configured like db, which is in WAL from now on
+    if (db->has_config) db->config.journal_mode = CORM_JOURNAL_WAL;
+
+    corm_pool_t* pool = corm_pool_create(db, readers);
+    if (!pool) return false;
+
+    // Nobody else can see the pool yet, so every connection is free; claim
+    // them all before handing any back or slot affinity returns the same one
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+    corm_db_t** conns = corm_arena_alloc(db->internal_arena, sizeof(corm_db_t*) * readers);
+    bool ok = conns != NULL;
+    size_t claimed = 0;
+    while (ok && claimed < readers) {
+        corm_db_t* conn = corm_pool_try_checkout(pool);
+        if (!conn) {
+            ok = false;
+            break;
+        }
+        conns[claimed++] = conn;
+        ok = db->backend->set_read_only(conn->backend_conn, true);
+    }
+    for (size_t i = 0; i < claimed; i++) {
+        corm_pool_checkin(pool, conns[i]);
+    }
+    corm_arena_end_temp(tmp);
+
+    if (!ok) {
+        CORM_SET_ERROR(db, "Failed to make connection read-only");
+        corm_pool_destroy(pool);
+        return false;
+    }
+
+    db->readers = pool;
+    return true;
+}
+
+corm_db_t* corm_init_with_readers(const char* db_filepath, size_t readers) {
+    corm_db_t* db = corm_init(db_filepath);
+    if (!db) return NULL;
+
+    if (!corm_enable_readers(db, readers)) {
+        corm_close(db);
+        return NULL;
+    }
+    return db;
+}
+
+void corm_set_allocator(corm_db_t* db, void* ctx,
+                        void* (*alloc_fn)(void*, size_t),
+                        void (*free_fn)(void*, void*)) {
+    corm_allocator_t old = db->allocator;
+
+    // Cached statements are cheap to prepare again, their table goes with
+    // the allocator that made it
+    corm_stmt_cache_destroy(db);
+
+    db->allocator.ctx = ctx;
+    db->allocator.alloc_fn = alloc_fn;
+    db->allocator.free_fn = free_fn;
+
+    // The model table and the registry outlive the switch, so they move to
+    // memory the new allocator can free
+    size_t size = sizeof(model_meta_t*) * db->model_capacity;
+    model_meta_t** models = corm_alloc_fn(db, size);
+    corm_registry_t* registry = NULL;
+    if (models && db->registry && !(registry = corm_registry_copy(db, db->registry))) {
+        corm_free_fn(db, models);
+        models = NULL;
+    }
+    if (!models) {
+        CORM_SET_ERROR(db, "Failed to move the model table to the new allocator");
+        db->allocator = old;
+        return;
+    }
+    memcpy(models, db->models, sizeof(model_meta_t*) * db->model_count);
+
+    corm_allocator_t current = db->allocator;
+    db->allocator = old;
+    corm_free_fn(db, db->models);
+    corm_registry_destroy(db);
+    db->allocator = current;
+    db->models = models;
+    db->registry = registry;
+}
+
+// Size-class allocator
+//
+// Blocks come in a few dozen sizes, including the struct_size of every
+// model registered when it's enabled. Each thread keeps its own free list
+// per class and only takes the lock to move a batch of blocks from or back
+// to the shared lists. The 16 bytes in front of a block hold its class;
+// anything bigger than the largest class goes to CORM_MALLOC.
+
+#define CORM_SC_MAX_CLASSES 48
+#define CORM_SC_MAX_BLOCK   (32u << 10)
+#define CORM_SC_HEADER      16
+#define CORM_SC_BATCH       32
+#define CORM_SC_CHUNK       (64u << 10)
+#define CORM_SC_LARGE       UINT32_MAX
+
+// Free blocks are linked through their payload
+typedef struct corm_sc_block_t {
+    struct corm_sc_block_t* next;
+} corm_sc_block_t;
+
+typedef struct corm_sc_cache_t {
+    corm_sc_block_t* free[CORM_SC_MAX_CLASSES];
+    size_t count[CORM_SC_MAX_CLASSES];  // also read by corm_size_class_stats
+    struct corm_sc_cache_t* prev;
+    struct corm_sc_cache_t* next;
+} corm_sc_cache_t;
+
+struct corm_size_classes_t {
+    size_t sizes[CORM_SC_MAX_CLASSES];  // ascending multiples of 16
+    size_t class_count;
+
+    pthread_key_t key;
+    pthread_mutex_t lock;
+    corm_sc_block_t* shared[CORM_SC_MAX_CLASSES];
+    size_t shared_count[CORM_SC_MAX_CLASSES];
+    size_t reserved[CORM_SC_MAX_CLASSES];
+    void* chunks;             // linked through their first word
+    corm_sc_cache_t* caches;  // one per thread that used the allocator
+};
+
+static const size_t corm_sc_base_sizes[] = {
+    16, 32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 768, 1024, 1536,
+    2048, 3072, 4096, 6144, 8192, 12288, 16384, 24576, 32768
+};
+
+static void corm_sc_add_size(corm_size_classes_t* sc, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (size == 0 || size > CORM_SC_MAX_BLOCK || sc->class_count == CORM_SC_MAX_CLASSES) return;
+
+    size_t i = 0;
+    while (i < sc->class_count && sc->sizes[i] < size) i++;
+    if (i < sc->class_count && sc->sizes[i] == size) return;
+
+    memmove(&sc->sizes[i + 1], &sc->sizes[i], sizeof(size_t) * (sc->class_count - i));
+    sc->sizes[i] = size;
+    sc->class_count++;
+}
+
+static uint32_t corm_sc_class(corm_size_classes_t* sc, size_t size) {
+    if (size > sc->sizes[sc->class_count - 1]) return CORM_SC_LARGE;
+
+    size_t lo = 0, hi = sc->class_count - 1;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (sc->sizes[mid] < size) lo = mid + 1;
+        else hi = mid;
+    }
+    return (uint32_t)lo;
+}
+
+// Moves up to `count` blocks of a class from `from` onto `to`, returns how many
+static size_t corm_sc_move(corm_sc_block_t** from, corm_sc_block_t** to, size_t count) {
+    size_t moved = 0;
+    while (moved < count && *from) {
+        corm_sc_block_t* block = *from;
+        *from = block->next;
+        block->next = *to;
+        *to = block;
+        moved++;
+    }
+    return moved;
+}
+
+// Thread exit: the thread's blocks go back to the shared lists
+static void corm_sc_cache_release(void* arg) {
+    corm_sc_cache_t* cache = (corm_sc_cache_t*)arg;
+    corm_size_classes_t* sc = *(corm_size_classes_t**)(cache + 1);
+
+    pthread_mutex_lock(&sc->lock);
+    for (size_t c = 0; c < sc->class_count; c++) {
+        sc->shared_count[c] += corm_sc_move(&cache->free[c], &sc->shared[c], cache->count[c]);
+    }
+    if (cache->prev) cache->prev->next = cache->next;
+    else sc->caches = cache->next;
+    if (cache->next) cache->next->prev = cache->prev;
+    pthread_mutex_unlock(&sc->lock);
+
+    CORM_FREE(cache);
+}
+
+static corm_sc_cache_t* corm_sc_cache(corm_size_classes_t* sc) {
+    corm_sc_cache_t* cache = pthread_getspecific(sc->key);
+    if (cache) return cache;
+
+    // The owner sits right behind the cache for the thread exit destructor
+    cache = CORM_MALLOC(sizeof(corm_sc_cache_t) + sizeof(corm_size_classes_t*));
+    if (!cache) return NULL;
+    memset(cache, 0, sizeof(corm_sc_cache_t));
+    *(corm_size_classes_t**)(cache + 1) = sc;
+
+    pthread_mutex_lock(&sc->lock);
+    cache->next = sc->caches;
+    if (sc->caches) sc->caches->prev = cache;
+    sc->caches = cache;
+    pthread_mutex_unlock(&sc->lock);
+
+    pthread_setspecific(sc->key, cache);
+    return cache;
+}
+
+// Called with the lock held
+static bool corm_sc_carve(corm_size_classes_t* sc, uint32_t cls) {
+    size_t stride = CORM_SC_HEADER + sc->sizes[cls];
+    size_t chunk_size = CORM_SC_CHUNK;
+    if (chunk_size < CORM_SC_HEADER + stride * CORM_SC_BATCH) {
+        chunk_size = CORM_SC_HEADER + stride * CORM_SC_BATCH;
+    }
+
+    char* chunk = CORM_MALLOC(chunk_size);
+    if (!chunk) return false;
+    *(void**)chunk = sc->chunks;
+    sc->chunks = chunk;
+
+    size_t blocks = (chunk_size - CORM_SC_HEADER) / stride;
+    for (size_t i = 0; i < blocks; i++) {
+        char* header = chunk + CORM_SC_HEADER + i * stride;
+        *(uint32_t*)header = cls;
+
+        corm_sc_block_t* block = (corm_sc_block_t*)(header + CORM_SC_HEADER);
+        block->next = sc->shared[cls];
+        sc->shared[cls] = block;
+    }
+    sc->shared_count[cls] += blocks;
+    sc->reserved[cls] += blocks;
+    return true;
+}
+
+static void* corm_sc_alloc(void* ctx, size_t size) {
+    corm_size_classes_t* sc = (corm_size_classes_t*)ctx;
+
+    uint32_t cls = corm_sc_class(sc, size);
+    if (cls == CORM_SC_LARGE) {
+        char* header = CORM_MALLOC(CORM_SC_HEADER + size);
+        if (!header) return NULL;
+        *(uint32_t*)header = CORM_SC_LARGE;
+        return header + CORM_SC_HEADER;
+    }
+
+    corm_sc_cache_t* cache = corm_sc_cache(sc);
+    if (!cache) return NULL;
+
+    if (!cache->free[cls]) {
+        pthread_mutex_lock(&sc->lock);
+        if (sc->shared_count[cls] == 0 && !corm_sc_carve(sc, cls)) {
+            pthread_mutex_unlock(&sc->lock);
+            return NULL;
+        }
+        size_t moved = corm_sc_move(&sc->shared[cls], &cache->free[cls], CORM_SC_BATCH);
+        sc->shared_count[cls] -= moved;
+        __atomic_store_n(&cache->count[cls], cache->count[cls] + moved, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&sc->lock);
+    }
+
+    corm_sc_block_t* block = cache->free[cls];
+    cache->free[cls] = block->next;
+    __atomic_store_n(&cache->count[cls], cache->count[cls] - 1, __ATOMIC_RELAXED);
+    return block;
+}
+
+static void corm_sc_free(void* ctx, void* ptr) {
+    if (!ptr) return;
+    corm_size_classes_t* sc = (corm_size_classes_t*)ctx;
+
+    char* header = (char*)ptr - CORM_SC_HEADER;
+    uint32_t cls = *(uint32_t*)header;
+    if (cls == CORM_SC_LARGE) {
+        CORM_FREE(header);
+        return;
+    }
+
+    corm_sc_block_t* block = (corm_sc_block_t*)ptr;
+    corm_sc_cache_t* cache = corm_sc_cache(sc);
+    if (!cache) {
+        pthread_mutex_lock(&sc->lock);
+        block->next = sc->shared[cls];
+        sc->shared[cls] = block;
+        sc->shared_count[cls]++;
+        pthread_mutex_unlock(&sc->lock);
+        return;
+    }
+
+    block->next = cache->free[cls];
+    cache->free[cls] = block;
+    size_t count = cache->count[cls] + 1;
+
+    // Bulk return, so a thread that only frees doesn't hoard memory
+    if (count > 2 * CORM_SC_BATCH) {
+        pthread_mutex_lock(&sc->lock);
+        size_t moved = corm_sc_move(&cache->free[cls], &sc->shared[cls], CORM_SC_BATCH);
+        sc->shared_count[cls] += moved;
+        count -= moved;
+        pthread_mutex_unlock(&sc->lock);
+    }
+    __atomic_store_n(&cache->count[cls], count, __ATOMIC_RELAXED);
+}
+
+static corm_size_classes_t* corm_sc_create(corm_db_t* db) {
+    corm_size_classes_t* sc = CORM_MALLOC(sizeof(corm_size_classes_t));
+    if (!sc) return NULL;
+    memset(sc, 0, sizeof(*sc));
+
+    for (size_t i = 0; i < sizeof(corm_sc_base_sizes) / sizeof(corm_sc_base_sizes[0]); i++) {
+        corm_sc_add_size(sc, corm_sc_base_sizes[i]);
+    }
+    // One row, and the 16-row array a query result starts with
+    for (size_t i = 0; i < db->model_count; i++) {
+        corm_sc_add_size(sc, db->models[i]->struct_size);
+        corm_sc_add_size(sc, db->models[i]->struct_size * 16);
+    }
+
+    if (pthread_key_create(&sc->key, corm_sc_cache_release) != 0) {
+        CORM_FREE(sc);
+        return NULL;
+    }
+    pthread_mutex_init(&sc->lock, NULL);
+    return sc;
+}
+
+// Every thread must be done with the allocator by now
+static void corm_sc_destroy(corm_size_classes_t* sc) {
+    pthread_key_delete(sc->key);
+
+    while (sc->caches) {
+        corm_sc_cache_t* next = sc->caches->next;
+        CORM_FREE(sc->caches);
+        sc->caches = next;
+    }
+    while (sc->chunks) {
+        void* next = *(void**)sc->chunks;
+        CORM_FREE(sc->chunks);
+        sc->chunks = next;
+    }
+    pthread_mutex_destroy(&sc->lock);
+    CORM_FREE(sc);
+}
+
+bool corm_use_size_classes(corm_db_t* db) {
+    if (db->size_classes) {
+        CORM_SET_ERROR(db, "The size-class allocator is already in use");
+        return false;
+    }
+
+    corm_size_classes_t* sc = corm_sc_create(db);
+    if (!sc) {
+        CORM_SET_ERROR(db, "Failed to create the size-class allocator");
+        return false;
+    }
+
+    corm_set_allocator(db, sc, corm_sc_alloc, corm_sc_free);
+    if (db->allocator.ctx != sc) {
+        corm_sc_destroy(sc);
+        return false;
+    }
+    db->size_classes = sc;
+    return true;
+}
+
+size_t corm_size_class_stats(corm_db_t* db, corm_size_class_stats_t* stats, size_t max) {
+    corm_size_classes_t* sc = db->size_classes;
+    if (!sc) return 0;
+
+    pthread_mutex_lock(&sc->lock);
+    size_t n = sc->class_count < max ? sc->class_count : max;
+    for (size_t c = 0; c < n; c++) {
+        size_t free_blocks = sc->shared_count[c];
+        for (corm_sc_cache_t* cache = sc->caches; cache; cache = cache->next) {
+            free_blocks += __atomic_load_n(&cache->count[c], __ATOMIC_RELAXED);
+        }
+        // Counts of other threads are a moment old, don't go below zero
+        if (free_blocks > sc->reserved[c]) free_blocks = sc->reserved[c];
+
+        stats[c].block_size = sc->sizes[c];
+        stats[c].reserved = sc->reserved[c];
+        stats[c].free = free_blocks;
+        stats[c].in_use = sc->reserved[c] - free_blocks;
+    }
+    pthread_mutex_unlock(&sc->lock);
+    return sc->class_count;
+}
+
+static void corm_write_buffer_destroy(corm_db_t* db);
+bool corm_set_shared(corm_db_t* db, bool enabled);
+
+void corm_close(corm_db_t* db) {
+    if (!db) return;
+    if (db->shared) {
+        corm_set_shared(db, false);
+    }
+    if (db->async) {
+        corm_async_disable(db);
+    }
+    if (db->readers) {
+        corm_pool_destroy(db->readers);
+    }
+    if (db->write_buffer) {
+        corm_flush(db);
+        corm_write_buffer_destroy(db);
+    }
+    corm_stmt_cache_destroy(db);
+    db->backend->disconnect(db->backend_conn);
+    corm_arena_destroy(db->internal_arena);
+    corm_free_fn(db, db->models);
+    corm_registry_destroy(db);
+    if (db->size_classes) corm_sc_destroy(db->size_classes);
+    CORM_FREE(db->connection_string);
+    CORM_FREE(db);
+}
+
+// Shared mode
+//
+// A shared corm_db_t hands every thread its own sibling connection, created
+// on first use and kept in thread-specific storage. All the mutable state
+// (arena, statement cache, last error, tracked results) therefore stays
+// per thread, while the model registry is shared and read-only after
+// corm_sync. Handles that aren't shared pay a single branch.
+struct corm_shared_t {
+    pthread_key_t key;
+    pthread_mutex_t lock;
+    corm_db_t** conns;
+    size_t conn_count;
+    size_t conn_capacity;
+};
+
+static void corm_shared_forget(corm_db_t* parent, corm_db_t* conn) {
+    corm_shared_t* shared = parent->shared;
+    for (size_t i = 0; i < shared->conn_count; i++) {
+        if (shared->conns[i] == conn) {
+            shared->conns[i] = shared->conns[--shared->conn_count];
+            return;
+        }
+    }
+}
+
+// Runs when a thread that used a shared handle exits
+static void corm_shared_thread_exit(void* value) {
+    corm_db_t* conn = (corm_db_t*)value;
+    corm_db_t* parent = conn->parent;
+
+    pthread_mutex_lock(&parent->shared->lock);
+    corm_shared_forget(parent, conn);
+    pthread_mutex_unlock(&parent->shared->lock);
+    corm_close(conn);
+}
+
+static corm_db_t* corm_thread_db(corm_db_t* db) {
+    corm_shared_t* shared = db->shared;
+    corm_db_t* conn = pthread_getspecific(shared->key);
+    if (conn) return conn;
+
+    pthread_mutex_lock(&shared->lock);
+    if (shared->conn_count == shared->conn_capacity) {
+        size_t new_cap = shared->conn_capacity ? shared->conn_capacity * 2 : 8;
+        corm_db_t** grown = CORM_MALLOC(sizeof(corm_db_t*) * new_cap);
+        if (!grown) {
+            pthread_mutex_unlock(&shared->lock);
+            return NULL;
+        }
+        if (shared->conns) {
+            memcpy(grown, shared->conns, sizeof(corm_db_t*) * shared->conn_count);
+            CORM_FREE(shared->conns);
+        }
+        shared->conns = grown;
+        shared->conn_capacity = new_cap;
+    }
+
+    conn = corm_open_sibling(db);
+    if (conn) {
+        conn->parent = db;
+        shared->conns[shared->conn_count++] = conn;
+    }
+    pthread_mutex_unlock(&shared->lock);
+
+    if (conn && pthread_setspecific(shared->key, conn) != 0) {
+        pthread_mutex_lock(&shared->lock);
+        corm_shared_forget(db, conn);
+        pthread_mutex_unlock(&shared->lock);
+        corm_close(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+// Picks the connection the calling thread should use for `db`
+static inline corm_db_t* corm_route(corm_db_t* db) {
+    if (!db || !db->shared) return db;
+    return corm_thread_db(db);
+}
+
+bool corm_set_shared(corm_db_t* db, bool enabled) {
+    if (enabled == (db->shared != NULL)) return true;
+    if (enabled && corm_private_database(db)) {
+        CORM_SET_ERROR(db, "Shared mode needs a database file, '%s' can't be shared", db->connection_string);
+        return false;
+    }
+
+    if (!enabled) {
+        corm_shared_t* shared = db->shared;
+        pthread_key_delete(shared->key);
+        for (size_t i = 0; i < shared->conn_count; i++) {
+            corm_close(shared->conns[i]);
+        }
+        pthread_mutex_destroy(&shared->lock);
+        CORM_FREE(shared->conns);
+        CORM_FREE(shared);
+        db->shared = NULL;
+        return true;
+    }
+
+    corm_shared_t* shared = CORM_MALLOC(sizeof(corm_shared_t));
+    if (!shared) {
+        CORM_SET_ERROR(db, "Failed to allocate shared state");
+        return false;
+    }
+    memset(shared, 0, sizeof(*shared));
+
+    if (pthread_key_create(&shared->key, corm_shared_thread_exit) != 0) {
+        CORM_SET_ERROR(db, "Failed to create thread-specific storage");
+        CORM_FREE(shared);
+        return false;
+    }
+    pthread_mutex_init(&shared->lock, NULL);
+    db->shared = shared;
+    return true;
+}
+
+corm_db_t* corm_connection(corm_db_t* db) {
+    if (!db) return NULL;
+    return corm_route(db);
+}
+
+const char* corm_get_last_error(corm_db_t* db) {
+    if (!db) return "Invalid database handle";
+    db = corm_route(db);
+    if (!db) return "Failed to open a connection for this thread";
+    return db->last_error;
+}
+
+corm_error_e corm_get_last_error_code(corm_db_t* db) {
+    if (!db) return CORM_ERROR_GENERIC;
+    db = corm_route(db);
+    if (!db) return CORM_ERROR_GENERIC;
+    return db->last_error_code;
+}
+
+static bool corm_register_model_impl(corm_db_t* db, model_meta_t* meta) {
+    field_info_t* pk_field = NULL;
+    int pk_count = 0;
+    
+    for (uint64_t i = 0; i < meta->field_count; i++) {
+        if (meta->fields[i].flags & PRIMARY_KEY) {
+            pk_field = &meta->fields[i];
+            pk_count++;
+        }
+    }
+    
+    if (pk_count == 0) {
+        CORM_SET_ERROR(db, "Model '%s' must have exactly one PRIMARY_KEY field", meta->table_name);
+        return false;
+    }
+    if (pk_count > 1) {
+        CORM_SET_ERROR(db, "Model '%s' has %d PRIMARY_KEY fields, expected 1", meta->table_name, pk_count);
+        return false;
+    }
+    
+    if (db->shared && db->synced) {
+        CORM_SET_ERROR(db, "Models can't be registered on a shared handle after corm_sync");
+        return false;
+    }
+
+    model_meta_t* known = corm_find_model(db, meta->table_name);
+    if (known == meta) return true;
+    if (known) {
+        CORM_SET_ERROR(db, "Another model is already registered for table '%s'", meta->table_name);
+        return false;
+    }
+
+    meta->primary_key_field = pk_field;
+    return corm_add_model(db, meta);
+}
+
+// Shared by extract_field_from_column and the DEFINE_MODEL_FAST decoders.
+// The copy lives as long as the result.
+bool corm_decode_string(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt, int col, char** out) {
+    const char* text = (const char*)CORM_BE(db, column_text)(stmt, col);
+    if (!text) return true;
+
+    size_t len = strlen(text);
+    char* str = corm_result_alloc(db, result, len + 1);
+    if (!str) return false;
+
+    memcpy(str, text, len + 1);
+    *out = str;
+    return true;
+}
+
+bool corm_decode_blob(corm_db_t* db, corm_result_t* result, corm_backend_stmt_t stmt, int col, blob_t* out) {
+    const void* blob_data = CORM_BE(db, column_blob)(stmt, col);
+    int blob_size = CORM_BE(db, column_bytes)(stmt, col);
+    if (!blob_data || blob_size <= 0) return true;
+
+    void* data = corm_result_alloc(db, result, blob_size);
+    if (!data) return false;
+
+    memcpy(data, blob_data, blob_size);
+    out->data = data;
+    out->size = blob_size;
+    return true;
+}
+
+typedef struct {
+    corm_db_t* db;
+    corm_result_t* result;
+    bool failed;
+} corm_plan_alloc_ctx_t;
+
+// Lets a backend's fetch_rows put strings and blobs in the result
+static void* corm_plan_alloc(void* ctx, size_t size) {
+    corm_plan_alloc_ctx_t* alloc_ctx = (corm_plan_alloc_ctx_t*)ctx;
+    void* ptr = corm_result_alloc(alloc_ctx->db, alloc_ctx->result, size);
+    if (!ptr) alloc_ctx->failed = true;
+    return ptr;
+}
+
+static bool extract_field_from_column(corm_db_t* db, corm_result_t* result,
+                                      corm_backend_stmt_t stmt, int col_idx,
+                                      void* field_ptr, field_type_e type) {
+    if (CORM_BE(db, column_type)(stmt, col_idx) == 0) {
+        return true;
+    }
+    
+    switch (type) {
+        case FIELD_TYPE_INT:
+            *(int*)field_ptr = CORM_BE(db, column_int)(stmt, col_idx);
+            break;
+        
+        case FIELD_TYPE_BOOL:
+            *(bool*)field_ptr = CORM_BE(db, column_int)(stmt, col_idx) != 0;
+            break;
+            
+        case FIELD_TYPE_INT64:
+            *(int64_t*)field_ptr = CORM_BE(db, column_int64)(stmt, col_idx);
+            break;
+            
+        case FIELD_TYPE_FLOAT:
+            *(float*)field_ptr = (float)CORM_BE(db, column_double)(stmt, col_idx);
+            break;
+            
+        case FIELD_TYPE_DOUBLE:
+            *(double*)field_ptr = CORM_BE(db, column_double)(stmt, col_idx);
+            break;
+            
+        case FIELD_TYPE_STRING:
+            return corm_decode_string(db, result, stmt, col_idx, (char**)field_ptr);
+        
+        case FIELD_TYPE_BLOB:
+            return corm_decode_blob(db, result, stmt, col_idx, (blob_t*)field_ptr);
+        
+        default:
+            return false;
+    }
+    
+    return true;
+}
+
+static bool bind_param_by_type(corm_db_t* db, corm_backend_stmt_t stmt, int param_idx,
+                                void* value_ptr, field_type_e type) {
+    switch (type) {
+        case FIELD_TYPE_INT:
+            return CORM_BE(db, bind_int)(stmt, param_idx, *(int*)value_ptr);
+            
+        case FIELD_TYPE_BOOL:
+            return CORM_BE(db, bind_int)(stmt, param_idx, *(bool*)value_ptr ? 1 : 0);
+            
+        case FIELD_TYPE_INT64:
+            return CORM_BE(db, bind_int64)(stmt, param_idx, *(int64_t*)value_ptr);
+            
+        case FIELD_TYPE_FLOAT:
+            return CORM_BE(db, bind_double)(stmt, param_idx, (double)(*(float*)value_ptr));
+            
+        case FIELD_TYPE_DOUBLE:
+            return CORM_BE(db, bind_double)(stmt, param_idx, *(double*)value_ptr);
+            
+        case FIELD_TYPE_STRING: {
+            char* str = *(char**)value_ptr;
+            if (str) {
+                return CORM_BE(db, bind_string)(stmt, param_idx, str, -1);
+            } else {
+                return CORM_BE(db, bind_null)(stmt, param_idx);
+            }
+        }
+        
+        case FIELD_TYPE_BLOB: {
+            blob_t* blob = (blob_t*)value_ptr;
+            if (blob->data && blob->size > 0) {
+                return CORM_BE(db, bind_blob)(stmt, param_idx, blob->data, blob->size);
+            } else {
+                return CORM_BE(db, bind_null)(stmt, param_idx);
+            }
+        }
+        
+        default:
+            CORM_SET_ERROR(db, "Unsupported field type for binding");
+            return false;
+    }
+}
+
+// Field masks are plain bitsets over meta->fields, so they only cover models
+// with up to 64 fields. Bigger models take the unmasked code paths.
+#define CORM_MASK_MAX_FIELDS 64
+
+static inline bool corm_model_maskable(model_meta_t* meta) {
+    return meta->field_count <= CORM_MASK_MAX_FIELDS;
+}
+
+// Every column an UPDATE by primary key may write
+static uint64_t corm_update_mask_all(model_meta_t* meta) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        if (!corm_is_column(field)) continue;
+        if (field->flags & PRIMARY_KEY || field->flags & AUTO_INC) continue;
+        mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+// Binds the fields in `mask`, in field order, from parameter `param` on.
+// Prefers the model's generated binder, then the backend's whole-row bind,
+// then one call per field. Returns the next free parameter, or -1.
+static int corm_bind_fields(corm_db_t* db, corm_backend_stmt_t stmt, model_meta_t* meta,
+                            const void* instance, uint64_t mask, int param) {
+    if (meta->bind_row) {
+        int next = meta->bind_row(db, stmt, instance, mask, param);
+        if (next < 0) CORM_SET_ERROR(db, "Failed to bind fields of %s", meta->table_name);
+        return next;
+    }
+
+    if (db->backend->bind_row) {
+        corm_column_plan_t columns[CORM_MASK_MAX_FIELDS];
+        size_t count = 0;
+        for (size_t i = 0; i < meta->field_count; i++) {
+            if (!(mask & (1ULL << i))) continue;
+            columns[count].offset = meta->fields[i].offset;
+            columns[count].type = meta->fields[i].type;
+            columns[count].index = param + (int)count;
+            count++;
+        }
+
+        corm_row_plan_t plan = { .columns = columns, .count = count, .row_size = meta->struct_size };
+        if (!db->backend->bind_row(stmt, &plan, instance)) {
+            CORM_SET_ERROR(db, "Failed to bind fields of %s", meta->table_name);
+            return -1;
+        }
+        return param + (int)count;
+    }
+
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (!(mask & (1ULL << i))) continue;
+
+        field_info_t* field = &meta->fields[i];
+        void* field_value = (char*)instance + field->offset;
+        if (!bind_param_by_type(db, stmt, param, field_value, field->type)) {
+            CORM_SET_ERROR(db, "Failed to bind parameter %d for field '%s'", param, field->name);
+            return -1;
+        }
+        param++;
+    }
+    return param;
+}
+
+static inline uint64_t corm_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Busy handling
+//
+// A step the backend reports as busy or locked is run again after a
+// jittered, exponentially growing sleep until it gets through or
+// config.busy_retry_ms runs out.
+
+#define CORM_BUSY_FIRST_WAIT_NS 50000ULL     // 50us
+#define CORM_BUSY_MAX_WAIT_NS   20000000ULL  // 20ms
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t wait_ns;
+} corm_busy_t;
+
+static inline bool corm_step_busy(int rc) {
+    return rc == CORM_STEP_BUSY || rc == CORM_STEP_LOCKED;
+}
+
+// xorshift, only has to keep threads that collided from waking up in step
+static uint64_t corm_busy_jitter(uint64_t bound) {
+    static _Thread_local uint64_t state = 0;
+    if (state == 0) state = corm_now_ns() ^ (uint64_t)(uintptr_t)&state;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return bound ? state % bound : 0;
+}
+
+// Sleeps before the next attempt after a busy step. Returns false once the
+// deadline has passed, the caller then reports the failure.
+static bool corm_busy_wait(corm_db_t* db, corm_busy_t* busy) {
+    uint64_t now = corm_now_ns();
+    uint64_t deadline = (uint64_t)(db->has_config ? db->config.busy_retry_ms : 0) * 1000000ULL;
+
+    if (busy->start_ns == 0) {
+        busy->start_ns = now;
+        busy->wait_ns = CORM_BUSY_FIRST_WAIT_NS;
+    }
+
+    uint64_t spent = now - busy->start_ns;
+    if (spent >= deadline) {
+        db->stats.busy_failures++;
+        return false;
+    }
+
+    // Somewhere in [wait/2, wait], never past the deadline
+    uint64_t sleep_ns = busy->wait_ns / 2 + corm_busy_jitter(busy->wait_ns / 2 + 1);
+    if (sleep_ns > deadline - spent) sleep_ns = deadline - spent;
+    struct timespec ts = { (time_t)(sleep_ns / 1000000000ULL), (long)(sleep_ns % 1000000000ULL) };
+    nanosleep(&ts, NULL);
+
+    busy->wait_ns = busy->wait_ns * 2 < CORM_BUSY_MAX_WAIT_NS ? busy->wait_ns * 2 : CORM_BUSY_MAX_WAIT_NS;
+    db->stats.busy_retries++;
+    db->stats.busy_wait_ns += corm_now_ns() - now;
+    return true;
+}
+
+static inline int corm_step(corm_db_t* db, corm_backend_stmt_t stmt) {
+    int rc = CORM_BE(db, step)(stmt);
+    if (!corm_step_busy(rc)) return rc;
+
+    corm_busy_t busy = { 0 };
+    while (corm_step_busy(rc) && corm_busy_wait(db, &busy)) {
+        rc = CORM_BE(db, step)(stmt);
+    }
+    return rc;
+}
+
+// Structured requests
+//
+// Statements on a model are described as a corm_request_t. Backends with
+// prepare_request get it as is, the rest get SQL rendered here with their
+// dialect hooks.
+
+// The next ? placeholder in sql, skipping string literals and quoted
+// identifiers ('...', "...", `...`, [...]), or NULL.
+static const char* corm_next_placeholder(const char* sql) {
+    for (const char* c = sql; *c; c++) {
+        char close;
+        switch (*c) {
+            case '?':  return c;
+            case '\'': close = '\''; break;
+            case '"':  close = '"'; break;
+            case '`':  close = '`'; break;
+            case '[':  close = ']'; break;
+            default:   continue;
+        }
+        // A doubled quote inside is an escaped one and needs no special
+        // case: it closes and reopens the literal
+        const char* end = strchr(c + 1, close);
+        if (!end) return NULL;
+        c = end;
+    }
+    return NULL;
+}
+
+// Translates each ? in a where clause to the backend's placeholder, numbering
+// them from first_param.
+static corm_string_t corm_translate_where(corm_db_t* db, const char* clause, int first_param) {
+    corm_string_t where = CORM_STR_LIT("");
+    const char* cur = clause;
+    int param_idx = first_param;
+    while (*cur) {
+        const char* next = corm_next_placeholder(cur);
+        if (!next) {
+            where = corm_str_cat(db->internal_arena, where,
+                    (corm_string_t){ (uint8_t*)cur, (uint64_t)strlen(cur) });
+            break;
+        }
+        where = corm_str_cat(db->internal_arena, where,
+                (corm_string_t){ (uint8_t*)cur, (uint64_t)(next - cur) });
+        const char* ph = db->backend->get_placeholder(param_idx++);
+        where = corm_str_cat(db->internal_arena, where,
+                (corm_string_t){ (uint8_t*)ph, (uint64_t)strlen(ph) });
+        cur = next + 1;
+    }
+    return where;
+}
+
+// A request shape is hashed from a byte stream. The same stream can be
+// written out (text != NULL) so that a cache can compare two shapes whose
+// hashes collide.
+typedef struct {
+    uint64_t hash;
+    uint8_t* text;
+    uint64_t size;
+} corm_shape_t;
+
+static inline void corm_shape_add(corm_shape_t* s, const void* data, size_t size) {
+    if (s->text) {
+        memcpy(s->text + s->size, data, size);
+    } else {
+        s->hash = corm_hash_bytes(s->hash, data, size);
+    }
+    s->size += size;
+}
+
+// The terminator keeps ("ab", "c") and ("a", "bc") apart
+static inline void corm_shape_str(corm_shape_t* s, const char* str) {
+    if (str) corm_shape_add(s, str, strlen(str));
+    corm_shape_add(s, "", 1);
+}
+
+static void corm_predicate_shape(corm_shape_t* s, const corm_predicate_t* p) {
+    int kind = p ? (int)p->kind : -1;
+    corm_shape_add(s, &kind, sizeof(kind));
+    if (!p) return;
+
+    switch (p->kind) {
+        case CORM_PRED_CMP:
+            corm_shape_str(s, p->column);
+            corm_shape_add(s, &p->cmp, sizeof(p->cmp));
+            corm_shape_add(s, &p->param, sizeof(p->param));
+            return;
+        case CORM_PRED_RAW:
+            corm_shape_str(s, p->sql);
+            corm_shape_add(s, &p->param, sizeof(p->param));
+            return;
+        case CORM_PRED_IN:
+            corm_shape_str(s, p->column);
+            corm_shape_add(s, &p->param, sizeof(p->param));
+            corm_shape_add(s, &p->count, sizeof(p->count));
+            return;
+        default:
+            corm_predicate_shape(s, p->left);
+            corm_predicate_shape(s, p->right);
+            return;
+    }
+}
+
+static void corm_request_shape_add(corm_shape_t* s, const corm_request_t* req) {
+    corm_shape_add(s, &req->op, sizeof(req->op));
+    corm_shape_str(s, req->table);
+    corm_shape_add(s, &req->column_count, sizeof(req->column_count));
+    for (size_t i = 0; i < req->column_count; i++) {
+        corm_shape_str(s, req->columns[i].name);
+        corm_shape_add(s, &req->columns[i].type, sizeof(req->columns[i].type));
+        corm_shape_add(s, &req->columns[i].add, sizeof(req->columns[i].add));
+    }
+    corm_predicate_shape(s, req->where);
+    corm_shape_str(s, req->order_by);
+    corm_shape_add(s, &req->limit, sizeof(req->limit));
+    corm_shape_add(s, &req->offset, sizeof(req->offset));
+    corm_shape_add(s, &req->param_count, sizeof(req->param_count));
+    if (req->param_count) {
+        corm_shape_add(s, req->param_types, sizeof(field_type_e) * req->param_count);
+    }
+}
+
+static uint64_t corm_request_shape(const corm_request_t* req) {
+    corm_shape_t s = { CORM_FNV_OFFSET, NULL, 0 };
+    corm_request_shape_add(&s, req);
+    return s.hash;
+}
+
+// The shape and the bytes it was hashed from, in arena memory, for the
+// statement cache to tell colliding shapes apart
+static bool corm_request_shape_text(corm_db_t* db, const corm_request_t* req, uint64_t* shape,
+                                    corm_string_t* text) {
+    corm_shape_t s = { CORM_FNV_OFFSET, NULL, 0 };
+    corm_request_shape_add(&s, req);
+
+    uint8_t* bytes = corm_arena_alloc(db->internal_arena, s.size);
+    if (!bytes) {
+        CORM_SET_ERROR(db, "Failed to allocate request shape");
+        return false;
+    }
+    *shape = s.hash;
+
+    s = (corm_shape_t){ 0, bytes, 0 };
+    corm_request_shape_add(&s, req);
+    *text = (corm_string_t){ bytes, s.size };
+    return true;
+}
+
+static corm_request_t corm_request_init(corm_request_op_e op, model_meta_t* meta) {
+    corm_request_t req = { 0 };
+    req.op = op;
+    req.table = meta->table_name;
+    req.primary_key = meta->primary_key_field ? meta->primary_key_field->name : NULL;
+    req.limit = -1;
+    return req;
+}
+
+// Every column of meta whose flags have none of `skip`. Arena memory.
+static bool corm_request_columns(corm_db_t* db, corm_request_t* req, model_meta_t* meta, int skip) {
+    corm_request_column_t* columns = corm_arena_alloc(db->internal_arena,
+                                                      sizeof(corm_request_column_t) * (meta->field_count + 1));
+    if (!columns) {
+        CORM_SET_ERROR(db, "Failed to allocate request columns");
+        return false;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (!corm_is_column(&meta->fields[i]) || (meta->fields[i].flags & skip)) continue;
+        columns[count].name = meta->fields[i].name;
+        columns[count].type = meta->fields[i].type;
+        count++;
+    }
+    req->columns = columns;
+    req->column_count = count;
+    return true;
+}
+
+// Parameter types: the written columns for INSERT/UPDATE, then `types`
+static bool corm_request_params(corm_db_t* db, corm_request_t* req, const field_type_e* types, size_t count) {
+    size_t written = (req->op == CORM_REQUEST_INSERT || req->op == CORM_REQUEST_UPDATE) ? req->column_count : 0;
+    field_type_e* all = corm_arena_alloc(db->internal_arena, sizeof(field_type_e) * (written + count + 1));
+    if (!all) {
+        CORM_SET_ERROR(db, "Failed to allocate request parameters");
+        return false;
+    }
+
+    for (size_t i = 0; i < written; i++) all[i] = req->columns[i].type;
+    if (count) memcpy(all + written, types, sizeof(field_type_e) * count);
+    req->param_types = all;
+    req->param_count = written + count;
+    return true;
+}
+
+static const char* corm_cmp_sql(corm_cmp_e cmp) {
+    switch (cmp) {
+        case CORM_CMP_EQ: return "=";
+        case CORM_CMP_NE: return "<>";
+        case CORM_CMP_LT: return "<";
+        case CORM_CMP_LE: return "<=";
+        case CORM_CMP_GT: return ">";
+        case CORM_CMP_GE: return ">=";
+    }
+    return "=";
+}
+
+static corm_string_t corm_predicate_sql(corm_db_t* db, const corm_predicate_t* p) {
+    corm_arena_t* arena = db->internal_arena;
+
+    switch (p->kind) {
+        case CORM_PRED_CMP:
+            return corm_str_fmt(arena, "%s %s %s", p->column, corm_cmp_sql(p->cmp),
+                                db->backend->get_placeholder(p->param));
+        case CORM_PRED_RAW:
+            return corm_translate_where(db, p->sql, p->param);
+        case CORM_PRED_IN: {
+            corm_string_t sql = corm_str_fmt(arena, "%s IN (", p->column);
+            for (int i = 0; i < p->count; i++) {
+                sql = corm_str_cat(arena, sql,
+                      corm_str_fmt(arena, "%s%s", i > 0 ? ", " : "", db->backend->get_placeholder(p->param + i)));
+            }
+            return corm_str_cat(arena, sql, CORM_STR_LIT(")"));
+        }
+        default: {
+            corm_string_t left = corm_predicate_sql(db, p->left);
+            corm_string_t right = corm_predicate_sql(db, p->right);
+            bool wrap_left = p->left->kind == CORM_PRED_AND || p->left->kind == CORM_PRED_OR ||
+                             p->left->kind == CORM_PRED_RAW;
+            bool wrap_right = p->right->kind == CORM_PRED_AND || p->right->kind == CORM_PRED_OR ||
+                              p->right->kind == CORM_PRED_RAW;
+            return corm_str_fmt(arena, "%s%.*s%s %s %s%.*s%s",
+                                wrap_left ? "(" : "", (int)left.size, left.str, wrap_left ? ")" : "",
+                                p->kind == CORM_PRED_AND ? "AND" : "OR",
+                                wrap_right ? "(" : "", (int)right.size, right.str, wrap_right ? ")" : "");
+        }
+    }
+}
+
+static const char* corm_request_sql(corm_db_t* db, const corm_request_t* req) {
+    corm_arena_t* arena = db->internal_arena;
+    corm_string_t sql = { 0 };
+
+    switch (req->op) {
+        case CORM_REQUEST_SELECT:
+            if (req->column_count == 0) {
+                sql = corm_str_fmt(arena, "SELECT * FROM %s", req->table);
+                break;
+            }
+            sql = CORM_STR_LIT("SELECT ");
+            for (size_t i = 0; i < req->column_count; i++) {
+                sql = corm_str_cat(arena, sql,
+                      corm_str_fmt(arena, i > 0 ? ", %s" : "%s", req->columns[i].name));
+            }
+            sql = corm_str_cat(arena, sql, corm_str_fmt(arena, " FROM %s", req->table));
+            break;
+
+        case CORM_REQUEST_INSERT: {
+            sql = corm_str_fmt(arena, "INSERT INTO %s (", req->table);
+            corm_string_t values = CORM_STR_LIT("VALUES (");
+            for (size_t i = 0; i < req->column_count; i++) {
+                const char* sep = i > 0 ? ", " : "";
+                sql = corm_str_cat(arena, sql, corm_str_fmt(arena, "%s%s", sep, req->columns[i].name));
+                values = corm_str_cat(arena, values,
+                         corm_str_fmt(arena, "%s%s", sep, db->backend->get_placeholder((int)i + 1)));
+            }
+            sql = corm_str_cat(arena, sql, CORM_STR_LIT(") "));
+            sql = corm_str_cat(arena, sql, values);
+            sql = corm_str_cat(arena, sql, CORM_STR_LIT(")"));
+            break;
+        }
+
+        case CORM_REQUEST_UPDATE:
+            sql = corm_str_fmt(arena, "UPDATE %s SET ", req->table);
+            for (size_t i = 0; i < req->column_count; i++) {
+                const char* name = req->columns[i].name;
+                const char* ph = db->backend->get_placeholder((int)i + 1);
+                sql = corm_str_cat(arena, sql, req->columns[i].add
+                      ? corm_str_fmt(arena, "%s%s=%s + %s", i > 0 ? ", " : "", name, name, ph)
+                      : corm_str_fmt(arena, "%s%s=%s", i > 0 ? ", " : "", name, ph));
+            }
+            break;
+
+        case CORM_REQUEST_DELETE:
+            sql = corm_str_fmt(arena, "DELETE FROM %s", req->table);
+            break;
+    }
+
+    if (req->where) {
+        corm_string_t where = corm_predicate_sql(db, req->where);
+        sql = corm_str_cat(arena, sql, corm_str_fmt(arena, " WHERE %.*s", (int)where.size, where.str));
+    }
+
+    if (req->order_by) {
+        sql = corm_str_cat(arena, sql, corm_str_fmt(arena, " ORDER BY %s", req->order_by));
+    }
+
+    if (req->limit != -1 || req->offset > 0) {
+        const char* limit_str = db->backend->get_limit_syntax(req->limit, req->offset);
+        sql = corm_str_cat(arena, sql, corm_str_fmt(arena, " %s", limit_str));
+    }
+
+    sql = corm_str_cat(arena, sql, CORM_STR_LIT(";"));
+    return corm_str_to_c_safe(arena, sql);
+}
+
+// Prepares req on `conn`, one of db's backend connections. Errors read
+// "Failed to prepare <what>: ..."
+static bool corm_prepare_request(corm_db_t* db, corm_backend_conn_t conn, corm_request_t* req,
+                                 corm_backend_stmt_t* stmt, const char* what) {
+    char* error = NULL;
+    bool ok;
+
+    if (db->backend->prepare_request) {
+        req->shape = corm_request_shape(req);
+        ok = db->backend->prepare_request(conn, stmt, req, &error);
+    } else {
+        corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+        ok = db->backend->prepare(conn, stmt, corm_request_sql(db, req), &error);
+        corm_arena_end_temp(tmp);
+    }
+
+    if (!ok) {
+        CORM_SET_ERROR(db, "Failed to prepare %s: %s", what, error ? error : "unknown");
+        if (error) free(error);
+        *stmt = NULL;
+    }
+    return ok;
+}
+
+// UPDATE ... SET <mask columns> WHERE pk=? [AND guard=?]
+static corm_backend_stmt_t corm_prepare_update_by_mask(corm_db_t* db, model_meta_t* meta, uint64_t mask,
+                                                       field_info_t* guard) {
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_UPDATE, meta);
+    corm_request_column_t* columns = corm_arena_alloc(db->internal_arena,
+                                                      sizeof(corm_request_column_t) * meta->field_count);
+    corm_backend_stmt_t stmt = NULL;
+    if (!columns) {
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (!(mask & (1ULL << i))) continue;
+        columns[req.column_count].name = meta->fields[i].name;
+        columns[req.column_count].type = meta->fields[i].type;
+        req.column_count++;
+    }
+    req.columns = columns;
+
+    int param = (int)req.column_count + 1;
+    corm_predicate_t by_pk = { .kind = CORM_PRED_CMP, .column = meta->primary_key_field->name,
+                               .cmp = CORM_CMP_EQ, .param = param };
+    corm_predicate_t by_guard = { .kind = CORM_PRED_CMP, .column = guard ? guard->name : NULL,
+                                  .cmp = CORM_CMP_EQ, .param = param + 1 };
+    corm_predicate_t both = { .kind = CORM_PRED_AND, .left = &by_pk, .right = &by_guard };
+    req.where = guard ? &both : &by_pk;
+
+    field_type_e types[2] = { meta->primary_key_field->type, guard ? guard->type : FIELD_TYPE_INT };
+    if (corm_request_params(db, &req, types, guard ? 2 : 1)) {
+        corm_prepare_request(db, db->backend_conn, &req, &stmt, "UPDATE");
+    }
+
+    corm_arena_end_temp(tmp);
+    return stmt;
+}
+
+// Runs a cached UPDATE of the columns in `mask` by primary key, optionally
+// guarded by `guard = guard_value`. Statements are cached per (model, kind,
+// key) so repeated partial updates skip SQL generation entirely.
+// Returns the number of affected rows, or -1 on error.
+static int64_t corm_exec_update(corm_db_t* db, model_meta_t* meta, void* instance, uint64_t mask,
+                                int kind, uint64_t key, field_info_t* guard, void* guard_value) {
+    field_info_t* pk_field = meta->primary_key_field;
+
+    bool cached = true;
+    corm_backend_stmt_t stmt = corm_stmt_cache_get(db, meta, kind, key, NULL);
+    if (!stmt) {
+        stmt = corm_prepare_update_by_mask(db, meta, mask, guard);
+        if (!stmt) return -1;
+        cached = corm_stmt_cache_put(db, meta, kind, key, NULL, stmt);
+    }
+
+    int param_idx = corm_bind_fields(db, stmt, meta, instance, mask, 1);
+    bool ok = param_idx > 0;
+
+    if (ok && !bind_param_by_type(db, stmt, param_idx++, (char*)instance + pk_field->offset, pk_field->type)) {
+        CORM_SET_ERROR(db, "Failed to bind primary key");
+        ok = false;
+    }
+
+    if (ok && guard && !bind_param_by_type(db, stmt, param_idx, guard_value, guard->type)) {
+        CORM_SET_ERROR(db, "Failed to bind expected value for field '%s'", guard->name);
+        ok = false;
+    }
+
+    if (ok && corm_step(db, stmt) < 0) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to execute UPDATE: %s", backend_err ? backend_err : "unknown error");
+        ok = false;
+    }
+
+    int64_t affected = -1;
+    if (ok) {
+        affected = db->backend->changes ? db->backend->changes(db->backend_conn) : 0;
+    }
+
+    corm_stmt_release(db, stmt, cached);
+    return affected;
+}
+
+static bool corm_update_by_mask(corm_db_t* db, model_meta_t* meta, void* instance, uint64_t mask) {
+    return corm_exec_update(db, meta, instance, mask, CORM_STMT_UPDATE, mask, NULL, NULL) >= 0;
+}
+
+// Points every relation at its model and its foreign key field: a column of
+// the model itself for BELONGS_TO, of the related model for HAS_MANY
+static bool corm_resolve_relationships(corm_db_t* db) {
+    for (size_t i = 0; i < db->model_count; i++) {
+        model_meta_t* model = db->models[i];
+        
+        for (size_t j = 0; j < model->field_count; j++) {
+            field_info_t* field = &model->fields[j];
+            if (corm_is_column(field)) continue;
+
+            field->related_model = corm_find_model(db, field->target_model_name);
+            if (!field->related_model) {
+                CORM_SET_ERROR(db, "Related model '%s' not found for field '%s'",
+                         field->target_model_name, field->name);
+                return false;
+            }
+
+            model_meta_t* owner = field->type == FIELD_TYPE_BELONGS_TO ? model : field->related_model;
+            field->fk_field = corm_field_by_name(db, owner, field->fk_column_name);
+            if (!field->fk_field || !corm_is_column(field->fk_field)) {
+                CORM_SET_ERROR(db, "Foreign key field '%s' not found in model '%s'",
+                         field->fk_column_name, owner->table_name);
+                field->fk_field = NULL;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool corm_table_exists(corm_db_t* db, const char* table_name) {
+    return db->backend->table_exists(db->backend_conn, table_name);
+}
+
+static bool corm_record_exists(corm_db_t* db, model_meta_t* meta, field_info_t* pk_field, void* pk_value) {
+    bool cached = true;
+    corm_backend_stmt_t stmt = corm_stmt_cache_get(db, meta, CORM_STMT_EXISTS, 0, NULL);
+    if (!stmt) {
+        corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+        // SELECT pk FROM table WHERE pk = ? LIMIT 1
+        corm_request_t req = corm_request_init(CORM_REQUEST_SELECT, meta);
+        corm_request_column_t key = { pk_field->name, pk_field->type, false };
+        corm_predicate_t by_pk = { .kind = CORM_PRED_CMP, .column = pk_field->name, .cmp = CORM_CMP_EQ, .param = 1 };
+        req.columns = &key;
+        req.column_count = 1;
+        req.where = &by_pk;
+        req.limit = 1;
+
+        bool ok = corm_request_params(db, &req, &pk_field->type, 1) &&
+                  corm_prepare_request(db, db->backend_conn, &req, &stmt, "statement");
+        corm_arena_end_temp(tmp);
+        if (!ok) return false;
+        cached = corm_stmt_cache_put(db, meta, CORM_STMT_EXISTS, 0, NULL, stmt);
+    }
+
+    if (!bind_param_by_type(db, stmt, 1, pk_value, pk_field->type)) {
+        corm_stmt_release(db, stmt, cached);
+        return false;
+    }
+
+    bool exists = corm_step(db, stmt) == 1;
+
+    corm_stmt_release(db, stmt, cached);
+    return exists;
+}
+
+static corm_string_t corm_generate_create_table_sql(corm_db_t* db, model_meta_t* meta) {
+    corm_string_t sql = corm_str_fmt(db->internal_arena, "CREATE TABLE IF NOT EXISTS %s (", meta->table_name);
+    
+    bool first = true;
+    for (uint64_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        
+        if (field->type == FIELD_TYPE_BELONGS_TO || field->type == FIELD_TYPE_HAS_MANY) {
+            continue;
+        }
+        
+        if (!first) {
+            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(", "));
+        }
+        
+        char type_buf[128];
+        const char* type_name = db->backend->get_type_name(field->type, field->max_length, type_buf, sizeof(type_buf));
+        corm_string_t col_def = corm_str_fmt(db->internal_arena, "%s %s", field->name, type_name);
+        sql = corm_str_cat(db->internal_arena, sql, col_def);
+        
+        if (field->flags & PRIMARY_KEY) {
+            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" PRIMARY KEY"));
+            if (field->flags & AUTO_INC) {
+                const char* auto_inc = db->backend->get_auto_increment();
+                if (auto_inc && strlen(auto_inc) > 0) {
+                    corm_string_t auto_inc_str = corm_str_fmt(db->internal_arena, " %s", auto_inc);
+                    sql = corm_str_cat(db->internal_arena, sql, auto_inc_str);
+                }
+            }
+        }
+        
+        if (field->flags & NOT_NULL) {
+            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" NOT NULL"));
+        }
+        
+        if (field->flags & UNIQUE) {
+            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" UNIQUE"));
+        }
+        
+        first = false;
+    }
+    
+    for (uint64_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+
+        if (field->type == FIELD_TYPE_BELONGS_TO) {
+            corm_string_t fk = corm_str_fmt(db->internal_arena, ", FOREIGN KEY (%s) REFERENCES %s(%s)",
+                field->fk_column_name,
+                field->target_model_name,
+                field->related_model->primary_key_field->name
+            );
+            
+            switch(field->on_delete) {
+                case FK_CASCADE:
+                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE CASCADE"));
+                    break;
+                case FK_SET_NULL:
+                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE SET NULL"));
+                    break;
+                case FK_RESTRICT:
+                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE RESTRICT"));
+                    break;
+                default: break;
+            }
+            
+            sql = corm_str_cat(db->internal_arena, sql, fk);
+        }
+    }
+    
+    sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(");"));
+    return sql;
+}
+
+// Hash of the CREATE TABLE statements of every registered model, in
+// registration order. Anything that changes the DDL changes the hash;
+// never 0, which is what a database that corm hasn't synced reports.
+static uint32_t corm_schema_fingerprint(corm_db_t* db) {
+    uint64_t h = CORM_FNV_OFFSET;
+    for (size_t i = 0; i < db->model_count; i++) {
+        corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+        corm_string_t sql = corm_generate_create_table_sql(db, db->models[i]);
+        h = corm_hash_bytes(h, sql.str, sql.size);
+        h = corm_hash_bytes(h, "", 1);
+        corm_arena_end_temp(tmp);
+    }
+
+    uint32_t fingerprint = (uint32_t)(h ^ (h >> 32));
+    return fingerprint ? fingerprint : 1;
+}
+
+// Registered models whose table is already in the database, gathered from
+// one list_tables call
+typedef struct {
+    corm_db_t* db;
+    model_meta_t** found;  // open addressing set of models
+    size_t slots;
+} corm_catalog_t;
+
+static inline size_t corm_catalog_slot(corm_catalog_t* catalog, model_meta_t* meta) {
+    return (size_t)corm_hash_bytes(CORM_FNV_OFFSET, &meta, sizeof(meta)) & (catalog->slots - 1);
+}
+
+static void corm_catalog_add(void* ctx, const char* name) {
+    corm_catalog_t* catalog = (corm_catalog_t*)ctx;
+    model_meta_t* meta = corm_find_model(catalog->db, name);
+    if (!meta) return;
+
+    size_t slot = corm_catalog_slot(catalog, meta);
+    while (catalog->found[slot] && catalog->found[slot] != meta) {
+        slot = (slot + 1) & (catalog->slots - 1);
+    }
+    catalog->found[slot] = meta;
+}
+
+static bool corm_catalog_has(corm_catalog_t* catalog, model_meta_t* meta) {
+    size_t slot = corm_catalog_slot(catalog, meta);
+    while (catalog->found[slot]) {
+        if (catalog->found[slot] == meta) return true;
+        slot = (slot + 1) & (catalog->slots - 1);
+    }
+    return false;
+}
+
+static bool corm_sync_execute(corm_db_t* db, const char* sql, const char* what, const char* table) {
+    char* error = NULL;
+    if (!db->backend->execute(db->backend_conn, sql, &error)) {
+        CORM_SET_ERROR(db, "Failed to %s table '%s': %s", what, table, error ? error : "unknown error");
+        if (error) free(error);
+        return false;
+    }
+    return true;
+}
+
+// Reads the catalog with one list_tables call into arena memory. Without
+// it (or if it fails) found stays NULL and every table is looked up alone.
+static void corm_catalog_read(corm_db_t* db, corm_catalog_t* catalog) {
+    *catalog = (corm_catalog_t){ db, NULL, corm_slots_for(db->model_count) };
+    if (!db->backend->list_tables) return;
+
+    catalog->found = corm_arena_alloc(db->internal_arena, sizeof(model_meta_t*) * catalog->slots);
+    if (catalog->found && !db->backend->list_tables(db->backend_conn, corm_catalog_add, catalog)) {
+        catalog->found = NULL;
+    }
+}
+
+static inline bool corm_catalog_exists(corm_catalog_t* catalog, model_meta_t* meta) {
+    return catalog->found ? corm_catalog_has(catalog, meta)
+                          : corm_table_exists(catalog->db, meta->table_name);
+}
+
+// Whether every registered model still has its table, e.g. none was
+// dropped or renamed behind corm's back since the last sync
+static bool corm_sync_tables_present(corm_db_t* db) {
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_catalog_t catalog;
+    corm_catalog_read(db, &catalog);
+
+    bool present = true;
+    for (size_t i = 0; present && i < db->model_count; i++) {
+        present = corm_catalog_exists(&catalog, db->models[i]);
+    }
+
+    corm_arena_end_temp(tmp);
+    return present;
+}
+
+// CREATE TABLE for every model that doesn't have one yet. With list_tables
+// the catalog is read once instead of once per model.
+static bool corm_sync_create_missing(corm_db_t* db) {
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_catalog_t catalog;
+    corm_catalog_read(db, &catalog);
+
+    for (size_t i = 0; i < db->model_count; i++) {
+        model_meta_t* meta = db->models[i];
+        if (corm_catalog_exists(&catalog, meta)) continue;
+
+        corm_temp_t create_tmp = corm_arena_start_temp(db->internal_arena);
+        corm_string_t create_sql = corm_generate_create_table_sql(db, meta);
+        bool ok = corm_sync_execute(db, corm_str_to_c_safe(db->internal_arena, create_sql), "create", meta->table_name);
+        corm_arena_end_temp(create_tmp);
+        if (!ok) {
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+    }
+
+    corm_arena_end_temp(tmp);
+    return true;
+}
+
+static bool corm_sync_drop_all(corm_db_t* db) {
+    for (size_t i = 0; i < db->model_count; i++) {
+        corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+        corm_string_t drop_sql = corm_str_fmt(db->internal_arena, "DROP TABLE IF EXISTS %s;",
+                                              db->models[i]->table_name);
+        bool ok = corm_sync_execute(db, corm_str_to_c_safe(db->internal_arena, drop_sql), "drop",
+                                    db->models[i]->table_name);
+        corm_arena_end_temp(tmp);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// All the DDL of a sync runs in one transaction, together with storing the
+// schema fingerprint. A database whose fingerprint already matches the
+// registered models and still has all their tables is left alone after
+// reading the fingerprint and the catalog.
+static bool corm_sync_impl(corm_db_t* db, corm_sync_mode_e mode) {
+    if (!corm_resolve_relationships(db)) {
+        return false;
+    }
+    if (mode == CORM_SYNC_MIGRATE) {
+        CORM_SET_ERROR(db, "CORM_SYNC_MIGRATE is not implemented yet");
+        return false;
+    }
+
+    // Cached statements may reference tables that are about to change
+    corm_stmt_cache_clear(db);
+
+    bool versioned = db->backend->get_schema_version && db->backend->set_schema_version;
+    uint32_t fingerprint = versioned ? corm_schema_fingerprint(db) : 0;
+    if (mode == CORM_SYNC_SAFE && versioned) {
+        uint32_t version = 0;
+        if (db->backend->get_schema_version(db->backend_conn, &version) && version == fingerprint &&
+            corm_sync_tables_present(db)) {
+            db->synced = true;
+            return true;
+        }
+    }
+
+    // Tables are dropped in registration order, whatever references them
+    if (mode == CORM_SYNC_DROP) {
+        db->backend->set_foreign_keys(db->backend_conn, false);
+    }
+
+    bool ok = db->backend->begin_transaction(db->backend_conn);
+    if (!ok) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to begin sync transaction: %s", backend_err ? backend_err : "unknown error");
+    }
+
+    if (ok && mode == CORM_SYNC_DROP) {
+        ok = corm_sync_drop_all(db);
+    }
+    if (ok) {
+        ok = corm_sync_create_missing(db);
+    }
+    if (ok && versioned && !db->backend->set_schema_version(db->backend_conn, fingerprint)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to store the schema fingerprint: %s", backend_err ? backend_err : "unknown error");
+        ok = false;
+    }
+
+    if (ok && !db->backend->commit(db->backend_conn)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to commit sync transaction: %s", backend_err ? backend_err : "unknown error");
+        ok = false;
+    }
+    if (!ok) {
+        db->backend->rollback(db->backend_conn);
+    }
+
+    if (mode == CORM_SYNC_DROP) {
+        db->backend->set_foreign_keys(db->backend_conn, true);
+    }
+    if (ok) db->synced = true;
+    return ok;
+}
+
+// Setup calls run on the handle itself. In shared mode the caller reads
+// errors through its own connection, so hand the message over.
+static bool corm_setup_result(corm_db_t* db, bool ok) {
+    if (!ok && db->shared) {
+        corm_db_t* conn = corm_route(db);
+        if (conn) memcpy(conn->last_error, db->last_error, sizeof(conn->last_error));
+    }
+    return ok;
+}
+
+bool corm_register_model(corm_db_t* db, model_meta_t* meta) {
+    return corm_setup_result(db, corm_register_model_impl(db, meta));
+}
+
+bool corm_sync(corm_db_t* db, corm_sync_mode_e mode) {
+    return corm_setup_result(db, corm_sync_impl(db, mode));
+}
+
+static bool corm_run_validators(corm_db_t* db, model_meta_t* meta, void* instance) {
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        if (field->validator) {
+            void* field_value = (char*)instance + field->offset;
+            const char* error_msg = NULL;
+            if (!field->validator(instance, field_value, &error_msg)) {
+                CORM_SET_ERROR(db, "Validation failed for field '%s': %s",
+                         field->name, error_msg ? error_msg : "Unknown error");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool corm_save_direct(corm_db_t* db, model_meta_t* meta, void* instance) {
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+    
+    field_info_t* pk_field = meta->primary_key_field;
+    if (!pk_field) {
+        CORM_SET_ERROR(db, "Primary key field not found in model '%s'", meta->table_name);
+        corm_arena_end_temp(tmp);
+        return false;
+    }
+
+    // Rows loaded by a tracking query only write the columns that changed
+    uint64_t* row_snapshot = corm_find_snapshot(db, meta, instance);
+    uint64_t dirty = 0;
+    bool tracked_update = false;
+    if (row_snapshot) {
+        dirty = corm_dirty_mask(meta, instance, row_snapshot);
+        if (dirty == 0) {
+            corm_arena_end_temp(tmp);
+            return true;
+        }
+        size_t pk_index = (size_t)(pk_field - meta->fields);
+        tracked_update = !(dirty & (1ULL << pk_index));
+        dirty &= corm_update_mask_all(meta);
+    }
+
+    for (uint64_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        if (tracked_update && !(dirty & (1ULL << i))) {
+            continue;
+        }
+        if (field->validator) {
+            void* field_value = (char*)instance + field->offset;
+            const char* error_msg = NULL;
+            if (!field->validator(instance, field_value, &error_msg)) {
+                CORM_SET_ERROR(db, "Validation failed for field '%s': %s", 
+                         field->name, error_msg ? error_msg : "Unknown error");
+                corm_arena_end_temp(tmp);
+                return false;
+            }
+        }
+    }
+    
+    if (tracked_update && dirty == 0) {
+        corm_snapshot_row(meta, instance, row_snapshot);
+        corm_arena_end_temp(tmp);
+        return true;
+    }
+
+    if (tracked_update) {
+        int64_t affected = corm_exec_update(db, meta, instance, dirty, CORM_STMT_UPDATE, dirty, NULL, NULL);
+        if (affected < 0) {
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+        // Zero rows means someone deleted the row since it was loaded. It
+        // gets written again in full like an untracked save would.
+        if (affected > 0 || !db->backend->changes) {
+            corm_snapshot_row(meta, instance, row_snapshot);
+            corm_arena_end_temp(tmp);
+            return true;
+        }
+        if (!corm_run_validators(db, meta, instance)) {
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+    }
+
+    void* pk_value = (char*)instance + pk_field->offset;
+    bool is_update = corm_record_exists(db, meta, pk_field, pk_value);
+
+    if (is_update && corm_model_maskable(meta)) {
+        bool ok = corm_update_by_mask(db, meta, instance, corm_update_mask_all(meta));
+        if (ok && row_snapshot) corm_snapshot_row(meta, instance, row_snapshot);
+        corm_arena_end_temp(tmp);
+        return ok;
+    }
+    
+    int kind = is_update ? CORM_STMT_SAVE_UPDATE : CORM_STMT_INSERT;
+    bool cached = true;
+    corm_backend_stmt_t stmt = corm_stmt_cache_get(db, meta, kind, 0, NULL);
+    if (!stmt) {
+        corm_request_t req = corm_request_init(is_update ? CORM_REQUEST_UPDATE : CORM_REQUEST_INSERT, meta);
+        bool listed = corm_request_columns(db, &req, meta, is_update ? (PRIMARY_KEY | AUTO_INC) : AUTO_INC);
+
+        corm_predicate_t by_pk = { .kind = CORM_PRED_CMP, .column = pk_field->name, .cmp = CORM_CMP_EQ,
+                                   .param = (int)req.column_count + 1 };
+        if (is_update) req.where = &by_pk;
+
+        if (!listed || !corm_request_params(db, &req, &pk_field->type, is_update ? 1 : 0) ||
+            !corm_prepare_request(db, db->backend_conn, &req, &stmt, is_update ? "UPDATE" : "INSERT")) {
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+        cached = corm_stmt_cache_put(db, meta, kind, 0, NULL, stmt);
+    }
+    
+    int param_idx = 1;
+    // Only inserts get here for models that fit in a mask, updates of those
+    // go through corm_update_by_mask
+    if (corm_model_maskable(meta)) {
+        // Same columns as the loop below: everything but AUTO_INC
+        size_t pk_index = (size_t)(pk_field - meta->fields);
+        uint64_t mask = corm_update_mask_all(meta);
+        if (!(pk_field->flags & AUTO_INC)) mask |= 1ULL << pk_index;
+
+        if (corm_bind_fields(db, stmt, meta, instance, mask, param_idx) < 0) {
+            corm_stmt_release(db, stmt, cached);
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+    } else {
+        for (uint64_t i = 0; i < meta->field_count; i++) {
+            field_info_t* field = &meta->fields[i];
+
+            if (field->type == FIELD_TYPE_BELONGS_TO || 
+                field->type == FIELD_TYPE_HAS_MANY) {
+                continue;
+            }
+        
+            if (field->flags & AUTO_INC) {
+                continue;
+            }
+        
+            if (is_update && (field->flags & PRIMARY_KEY)) {
+                continue;
+            }
+        
+            void* field_value = (char*)instance + field->offset;
+        
+            if (!bind_param_by_type(db, stmt, param_idx, field_value, field->type)) {
+                CORM_SET_ERROR(db, "Failed to bind parameter %d for field '%s'", param_idx, field->name);
+                corm_stmt_release(db, stmt, cached);
+                corm_arena_end_temp(tmp);
+                return false;
+            }
+        
+            param_idx++;
+        }
+    }
+    
+    if (is_update) {
+        if (!bind_param_by_type(db, stmt, param_idx, pk_value, pk_field->type)) {
+            corm_stmt_release(db, stmt, cached);
+            corm_arena_end_temp(tmp);
+            return false;
+        }
+    }
+    
+    int result = corm_step(db, stmt);
+    if (result < 0) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to execute %s: %s", 
+                       is_update ? "UPDATE" : "INSERT",
+                       backend_err ? backend_err : "unknown error");
+        corm_stmt_release(db, stmt, cached);
+        corm_arena_end_temp(tmp);
+        return false;
+    }
+    
+    if (!is_update && (pk_field->flags & AUTO_INC)) {
+        int64_t last_id = db->backend->last_insert_id(db->backend_conn);
+        
+        void* pk_ptr = (char*)instance + pk_field->offset;
+        if (pk_field->type == FIELD_TYPE_INT) {
+            *(int*)pk_ptr = (int)last_id;
+        } else if (pk_field->type == FIELD_TYPE_INT64) {
+            *(int64_t*)pk_ptr = last_id;
+        }
+    }
+    
+    corm_stmt_release(db, stmt, cached);
+    if (row_snapshot) corm_snapshot_row(meta, instance, row_snapshot);
+    corm_arena_end_temp(tmp);
+    return true;
+}
+
+// Write-behind buffer
+//
+// Saves are deep-copied into a fixed size table, keyed by (model, primary
+// key). Saving the same row again replaces the queued copy. The whole table
+// is written in one transaction when it fills up, when the oldest entry gets
+// older than the configured delay (checked on every save), or on corm_flush.
+typedef struct {
+    model_meta_t* meta;
+    void* copy;
+} corm_pending_t;
+
+struct corm_write_buffer_t {
+    corm_pending_t* entries;
+    size_t count;
+    size_t max_entries;
+
+    // Open addressing index over entries, storing entry index + 1
+    size_t* index;
+    size_t index_capacity;
+
+    uint64_t max_delay_ns;
+    uint64_t oldest_ns;
+    bool flushing;
+};
+
+static bool corm_field_equal(const void* a, const void* b, field_type_e type) {
+    if (type == FIELD_TYPE_STRING) {
+        const char* sa = *(char* const*)a;
+        const char* sb = *(char* const*)b;
+        if (!sa || !sb) return sa == sb;
+        return strcmp(sa, sb) == 0;
+    }
+    return corm_field_fingerprint(a, type) == corm_field_fingerprint(b, type);
+}
+
+static void corm_instance_free(corm_db_t* db, model_meta_t* meta, void* copy) {
+    if (!copy) return;
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        void* field_ptr = (char*)copy + field->offset;
+        if (field->type == FIELD_TYPE_STRING && *(char**)field_ptr) {
+            corm_free_fn(db, *(char**)field_ptr);
+        } else if (field->type == FIELD_TYPE_BLOB && ((blob_t*)field_ptr)->data) {
+            corm_free_fn(db, ((blob_t*)field_ptr)->data);
+        }
+    }
+    corm_free_fn(db, copy);
+}
+
+// Copies an instance together with its strings and blobs. Relations are not
+// copied, saving never looks at them.
+static void* corm_instance_clone(corm_db_t* db, model_meta_t* meta, const void* instance) {
+    void* copy = corm_alloc_fn(db, meta->struct_size);
+    if (!copy) return NULL;
+    memcpy(copy, instance, meta->struct_size);
+
+    for (size_t i = 0; i < meta->field_count; i++) {
+        field_info_t* field = &meta->fields[i];
+        void* field_ptr = (char*)copy + field->offset;
+
+        switch (field->type) {
+            case FIELD_TYPE_STRING: {
+                const char* str = *(char**)field_ptr;
+                *(char**)field_ptr = NULL;
+                if (!str) break;
+                size_t len = strlen(str);
+                char* dup = corm_alloc_fn(db, len + 1);
+                if (!dup) {
+                    corm_instance_free(db, meta, copy);
+                    return NULL;
+                }
+                memcpy(dup, str, len + 1);
+                *(char**)field_ptr = dup;
+                break;
+            }
+            case FIELD_TYPE_BLOB: {
+                blob_t* blob = (blob_t*)field_ptr;
+                const void* data = blob->data;
+                blob->data = NULL;
+                if (!data || blob->size == 0) break;
+                void* dup = corm_alloc_fn(db, blob->size);
+                if (!dup) {
+                    corm_instance_free(db, meta, copy);
+                    return NULL;
+                }
+                memcpy(dup, data, blob->size);
+                blob->data = dup;
+                break;
+            }
+            case FIELD_TYPE_BELONGS_TO:
+                *(void**)field_ptr = NULL;
+                break;
+            case FIELD_TYPE_HAS_MANY:
+                *(void**)field_ptr = NULL;
+                *(int*)((char*)copy + field->count_offset) = 0;
+                break;
+            default:
+                break;
+        }
+    }
+    return copy;
+}
+
+static void corm_write_buffer_clear(corm_db_t* db) {
+    corm_write_buffer_t* wb = db->write_buffer;
+    for (size_t i = 0; i < wb->count; i++) {
+        corm_instance_free(db, wb->entries[i].meta, wb->entries[i].copy);
+    }
+    wb->count = 0;
+    memset(wb->index, 0, sizeof(size_t) * wb->index_capacity);
+}
+
+bool corm_flush(corm_db_t* db) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    corm_write_buffer_t* wb = db->write_buffer;
+    if (!wb || wb->count == 0 || wb->flushing) return true;
+
+    uint64_t start = corm_now_ns();
+    wb->flushing = true;
+
+    if (!db->backend->begin_transaction(db->backend_conn)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to begin transaction: %s", backend_err ? backend_err : "unknown error");
+        wb->flushing = false;
+        return false;
+    }
+
+    for (size_t i = 0; i < wb->count; i++) {
+        if (!corm_save_direct(db, wb->entries[i].meta, wb->entries[i].copy)) {
+            // Keep the queue as is, the caller decides whether to retry
+            db->backend->rollback(db->backend_conn);
+            wb->flushing = false;
+            return false;
+        }
+    }
+
+    if (!db->backend->commit(db->backend_conn)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to commit write buffer: %s", backend_err ? backend_err : "unknown error");
+        db->backend->rollback(db->backend_conn);
+        wb->flushing = false;
+        return false;
+    }
+
+    corm_write_buffer_clear(db);
+    wb->flushing = false;
+
+    uint64_t elapsed = corm_now_ns() - start;
+    db->stats.flush_count++;
+    db->stats.flush_last_ns = elapsed;
+    db->stats.flush_total_ns += elapsed;
+    if (elapsed > db->stats.flush_max_ns) {
+        db->stats.flush_max_ns = elapsed;
+    }
+    return true;
+}
+
+// Writes that bypass the buffer flush it first so they land in order
+static inline bool corm_write_barrier(corm_db_t* db) {
+    if (!db->write_buffer || db->write_buffer->flushing) return true;
+    return corm_flush(db);
+}
+
+bool corm_write_behind_enable(corm_db_t* db, size_t max_entries, uint32_t max_delay_ms) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    if (max_entries == 0) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_write_behind_enable");
+        return false;
+    }
+    if (!corm_write_behind_disable(db)) {
+        return false;
+    }
+
+    corm_write_buffer_t* wb = CORM_MALLOC(sizeof(corm_write_buffer_t));
+    if (!wb) {
+        CORM_SET_ERROR(db, "Failed to allocate write buffer");
+        return false;
+    }
+    memset(wb, 0, sizeof(*wb));
+
+    wb->index_capacity = 16;
+    while (wb->index_capacity < max_entries * 2) wb->index_capacity <<= 1;
+
+    wb->entries = CORM_MALLOC(sizeof(corm_pending_t) * max_entries);
+    wb->index = CORM_MALLOC(sizeof(size_t) * wb->index_capacity);
+    if (!wb->entries || !wb->index) {
+        CORM_FREE(wb->entries);
+        CORM_FREE(wb->index);
+        CORM_FREE(wb);
+        CORM_SET_ERROR(db, "Failed to allocate write buffer");
+        return false;
+    }
+    memset(wb->index, 0, sizeof(size_t) * wb->index_capacity);
+
+    wb->max_entries = max_entries;
+    wb->max_delay_ns = (uint64_t)max_delay_ms * 1000000ULL;
+    db->write_buffer = wb;
+    return true;
+}
+
+static void corm_write_buffer_destroy(corm_db_t* db) {
+    corm_write_buffer_clear(db);
+    CORM_FREE(db->write_buffer->entries);
+    CORM_FREE(db->write_buffer->index);
+    CORM_FREE(db->write_buffer);
+    db->write_buffer = NULL;
+}
+
+bool corm_write_behind_disable(corm_db_t* db) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    if (!db->write_buffer) return true;
+    if (!corm_flush(db)) return false;
+    corm_write_buffer_destroy(db);
+    return true;
+}
+
+size_t corm_write_behind_discard(corm_db_t* db) {
+    db = corm_route(db);
+    if (!db) return 0;
+
+    corm_write_buffer_t* wb = db->write_buffer;
+    if (!wb || wb->flushing) return 0;
+
+    size_t dropped = wb->count;
+    corm_write_buffer_clear(db);
+    return dropped;
+}
+
+static bool corm_write_buffer_save(corm_db_t* db, model_meta_t* meta, void* instance) {
+    corm_write_buffer_t* wb = db->write_buffer;
+    field_info_t* pk_field = meta->primary_key_field;
+    if (!pk_field) {
+        CORM_SET_ERROR(db, "Primary key field not found in model '%s'", meta->table_name);
+        return false;
+    }
+
+    void* pk_value = (char*)instance + pk_field->offset;
+    uint64_t pk_hash = corm_field_fingerprint(pk_value, pk_field->type);
+
+    // A fresh auto increment row has no key to coalesce on, and the caller
+    // expects the id back right away
+    if ((pk_field->flags & AUTO_INC) && pk_hash == 0) {
+        return corm_save_direct(db, meta, instance);
+    }
+
+    // Validation errors belong to the caller, not to whoever flushes later
+    if (!corm_run_validators(db, meta, instance)) {
+        return false;
+    }
+
+    void* copy = corm_instance_clone(db, meta, instance);
+    if (!copy) {
+        CORM_SET_ERROR(db, "Failed to copy instance into the write buffer");
+        return false;
+    }
+
+    db->stats.write_buffer_saves++;
+
+    uint64_t h = corm_hash_bytes(CORM_FNV_OFFSET, &meta, sizeof(meta));
+    h = corm_hash_bytes(h, &pk_hash, sizeof(pk_hash));
+    size_t slot = (size_t)(h & (wb->index_capacity - 1));
+    while (wb->index[slot]) {
+        corm_pending_t* e = &wb->entries[wb->index[slot] - 1];
+        if (e->meta == meta &&
+            corm_field_equal((char*)e->copy + pk_field->offset, pk_value, pk_field->type)) {
+            corm_instance_free(db, meta, e->copy);
+            e->copy = copy;
+            db->stats.write_buffer_coalesced++;
+            goto queued;
+        }
+        slot = (slot + 1) & (wb->index_capacity - 1);
+    }
+
+    // A failed flush leaves the queue full, give it one more try before
+    // refusing new keys
+    if (wb->count >= wb->max_entries && !corm_flush(db)) {
+        corm_instance_free(db, meta, copy);
+        char flush_err[sizeof(db->last_error)];
+        memcpy(flush_err, db->last_error, sizeof(flush_err));
+        CORM_SET_ERROR_CODE(db, db->last_error_code, "Write buffer is full and can't be flushed: %.400s", flush_err);
+        return false;
+    }
+    if (wb->count == 0) {
+        // The flush above emptied the table the probe ran against
+        slot = (size_t)(h & (wb->index_capacity - 1));
+        wb->oldest_ns = corm_now_ns();
+    }
+    wb->entries[wb->count] = (corm_pending_t){ meta, copy };
+    wb->index[slot] = ++wb->count;
+
+queued:
+    if (wb->count >= wb->max_entries ||
+        (wb->max_delay_ns > 0 && corm_now_ns() - wb->oldest_ns >= wb->max_delay_ns)) {
+        return corm_flush(db);
+    }
+    return true;
+}
+
+bool corm_save(corm_db_t* db, model_meta_t* meta, void* instance) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    if (db->write_buffer && !db->write_buffer->flushing) {
+        return corm_write_buffer_save(db, meta, instance);
+    }
+    return corm_save_direct(db, meta, instance);
+}
+
+void corm_get_stats(corm_db_t* db, corm_stats_t* stats) {
+    db = corm_route(db);
+    if (!db) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    *stats = db->stats;
+    stats->write_buffer_depth = db->write_buffer ? db->write_buffer->count : 0;
+    stats->write_buffer_coalesce_ratio = stats->write_buffer_saves > 0
+        ? (double)stats->write_buffer_coalesced / (double)stats->write_buffer_saves
+        : 0.0;
+}
+
+corm_field_mask_t corm_field_mask(corm_db_t* db, model_meta_t* meta, const char** fields, size_t count) {
+    db = corm_route(db);
+    if (!db) return 0;
+
+    if (!corm_model_maskable(meta)) {
+        CORM_SET_ERROR(db, "Model '%s' has more than %d fields, field masks are not supported",
+                       meta->table_name, CORM_MASK_MAX_FIELDS);
+        return 0;
+    }
+
+    corm_field_mask_t mask = 0;
+    for (size_t n = 0; n < count; n++) {
+        field_info_t* field = corm_field_by_name(db, meta, fields[n]);
+        if (!field) {
+            CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", fields[n], meta->table_name);
+            return 0;
+        }
+        if (!corm_is_column(field)) {
+            CORM_SET_ERROR(db, "Field '%s' is a relation and can't be updated", field->name);
+            return 0;
+        }
+        if (field->flags & PRIMARY_KEY || field->flags & AUTO_INC) {
+            CORM_SET_ERROR(db, "Field '%s' is a key and can't be updated", field->name);
+            return 0;
+        }
+        mask |= 1ULL << (size_t)(field - meta->fields);
+    }
+
+    if (mask == 0) {
+        CORM_SET_ERROR(db, "No fields given for %s", meta->table_name);
+    }
+    return mask;
+}
+
+bool corm_update_mask(corm_db_t* db, model_meta_t* meta, void* instance, corm_field_mask_t mask) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    if (!meta->primary_key_field) {
+        CORM_SET_ERROR(db, "Primary key field not found in model '%s'", meta->table_name);
+        return false;
+    }
+    if (!corm_model_maskable(meta) || mask == 0 || (mask & ~corm_update_mask_all(meta))) {
+        CORM_SET_ERROR(db, "Invalid field mask for model '%s'", meta->table_name);
+        return false;
+    }
+    if (!corm_write_barrier(db)) {
+        return false;
+    }
+
+    // Untouched fields keep whatever they had, so only their validators matter
+    for (size_t i = 0; i < meta->field_count; i++) {
+        if (!(mask & (1ULL << i))) continue;
+        field_info_t* field = &meta->fields[i];
+        if (field->validator) {
+            void* field_value = (char*)instance + field->offset;
+            const char* error_msg = NULL;
+            if (!field->validator(instance, field_value, &error_msg)) {
+                CORM_SET_ERROR(db, "Validation failed for field '%s': %s",
+                         field->name, error_msg ? error_msg : "Unknown error");
+                return false;
+            }
+        }
+    }
+
+    if (!corm_update_by_mask(db, meta, instance, mask)) {
+        return false;
+    }
+
+    uint64_t* row_snapshot = corm_find_snapshot(db, meta, instance);
+    if (row_snapshot) {
+        corm_snapshot_fields(meta, instance, row_snapshot, mask);
+    }
+    return true;
+}
+
+bool corm_update_fields(corm_db_t* db, model_meta_t* meta, void* instance, const char** fields, size_t count) {
+    corm_field_mask_t mask = corm_field_mask(db, meta, fields, count);
+    if (mask == 0) return false;
+    return corm_update_mask(db, meta, instance, mask);
+}
+
+int64_t corm_increment(corm_db_t* db, model_meta_t* meta, void* pk_value, const char* field_name, int64_t delta) {
+    db = corm_route(db);
+    if (!db) return -1;
+
+    if (!meta || !pk_value || !field_name) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_increment");
+        return -1;
+    }
+
+    field_info_t* pk_field = meta->primary_key_field;
+    if (!pk_field) {
+        CORM_SET_ERROR(db, "Model '%s' has no primary key", meta->table_name);
+        return -1;
+    }
+    if (!db->backend->changes) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't report affected rows", db->backend->name);
+        return -1;
+    }
+
+    field_info_t* field = corm_field_by_name(db, meta, field_name);
+    if (!field) {
+        CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", field_name, meta->table_name);
+        return -1;
+    }
+    if (field->type != FIELD_TYPE_INT && field->type != FIELD_TYPE_INT64 &&
+        field->type != FIELD_TYPE_FLOAT && field->type != FIELD_TYPE_DOUBLE) {
+        CORM_SET_ERROR(db, "Field '%s' is not numeric and can't be incremented", field->name);
+        return -1;
+    }
+    if (field == pk_field) {
+        CORM_SET_ERROR(db, "Primary key '%s' can't be incremented", field->name);
+        return -1;
+    }
+    if (!corm_write_barrier(db)) {
+        return -1;
+    }
+
+    uint64_t key = (uint64_t)(field - meta->fields);
+    bool cached = true;
+    corm_backend_stmt_t stmt = corm_stmt_cache_get(db, meta, CORM_STMT_INCREMENT, key, NULL);
+    if (!stmt) {
+        corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+        corm_request_t req = corm_request_init(CORM_REQUEST_UPDATE, meta);
+        // The delta binds as an integer whatever the column type
+        corm_request_column_t column = { field->name, FIELD_TYPE_INT64, true };
+        corm_predicate_t by_pk = { .kind = CORM_PRED_CMP, .column = pk_field->name, .cmp = CORM_CMP_EQ, .param = 2 };
+        req.columns = &column;
+        req.column_count = 1;
+        req.where = &by_pk;
+
+        bool ok = corm_request_params(db, &req, &pk_field->type, 1) &&
+                  corm_prepare_request(db, db->backend_conn, &req, &stmt, "UPDATE");
+        corm_arena_end_temp(tmp);
+        if (!ok) return -1;
+        cached = corm_stmt_cache_put(db, meta, CORM_STMT_INCREMENT, key, NULL, stmt);
+    }
+
+    int64_t affected = -1;
+    if (!CORM_BE(db, bind_int64)(stmt, 1, delta) ||
+        !bind_param_by_type(db, stmt, 2, pk_value, pk_field->type)) {
+        CORM_SET_ERROR(db, "Failed to bind parameters for increment of '%s'", field->name);
+    } else if (corm_step(db, stmt) < 0) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to execute UPDATE: %s", backend_err ? backend_err : "unknown error");
+    } else {
+        affected = db->backend->changes(db->backend_conn);
+    }
+
+    corm_stmt_release(db, stmt, cached);
+    return affected;
+}
+
+int64_t corm_update_if(corm_db_t* db, model_meta_t* meta, void* instance, const char* field_name, void* expected) {
+    db = corm_route(db);
+    if (!db) return -1;
+
+    if (!meta || !instance || !field_name || !expected) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_update_if");
+        return -1;
+    }
+    if (!meta->primary_key_field) {
+        CORM_SET_ERROR(db, "Model '%s' has no primary key", meta->table_name);
+        return -1;
+    }
+    if (!corm_model_maskable(meta)) {
+        CORM_SET_ERROR(db, "Model '%s' has more than %d fields, conditional updates are not supported",
+                       meta->table_name, CORM_MASK_MAX_FIELDS);
+        return -1;
+    }
+    if (!db->backend->changes) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't report affected rows", db->backend->name);
+        return -1;
+    }
+
+    field_info_t* guard = corm_field_by_name(db, meta, field_name);
+    if (!guard || !corm_is_column(guard)) {
+        CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", field_name, meta->table_name);
+        return -1;
+    }
+
+    if (!corm_run_validators(db, meta, instance)) {
+        return -1;
+    }
+    if (!corm_write_barrier(db)) {
+        return -1;
+    }
+
+    uint64_t key = (uint64_t)(guard - meta->fields);
+    int64_t affected = corm_exec_update(db, meta, instance, corm_update_mask_all(meta),
+                                        CORM_STMT_UPDATE_IF, key, guard, expected);
+
+    if (affected > 0) {
+        uint64_t* row_snapshot = corm_find_snapshot(db, meta, instance);
+        if (row_snapshot) corm_snapshot_row(meta, instance, row_snapshot);
+    }
+    return affected;
+}
+
+corm_query_t* corm_query(corm_db_t* db, model_meta_t* meta) {
+    if (!db || !meta) return NULL;
+
+    corm_query_t* q = corm_alloc_fn(db, sizeof(corm_query_t));
+    if (!q) return NULL;
+
+    corm_query_init(q, db, meta);
+    q->caller_owned = false;
+    return q;
+}
+
+void corm_query_init(corm_query_t* q, corm_db_t* db, model_meta_t* meta) {
+    q->db          = db;
+    q->meta        = meta;
+    q->where_clause = NULL;
+    q->params      = NULL;
+    q->param_types = NULL;
+    q->param_count = 0;
+    q->order_by    = NULL;
+    q->limit       = -1;
+    q->offset      = 0;
+    q->track_changes = false;
+    q->read_your_writes = false;
+    q->timeout_ms  = 0;
+    q->cancel      = NULL;
+    q->caller_owned = true;
+}
+
+void corm_query_where(corm_query_t* q, const char* clause,
+                      void** params, field_type_e* types, size_t count) {
+    q->where_clause = clause;
+    q->params       = params;
+    q->param_types  = types;
+    q->param_count  = count;
+}
+
+void corm_query_order_by(corm_query_t* q, const char* order_by) {
+    q->order_by = order_by;
+}
+
+void corm_query_limit(corm_query_t* q, int limit) {
+    q->limit = limit;
+}
+
+void corm_query_offset(corm_query_t* q, int offset) {
+    q->offset = offset;
+}
+
+void corm_query_track_changes(corm_query_t* q, bool enabled) {
+    q->track_changes = enabled;
+}
+
+void corm_query_read_your_writes(corm_query_t* q, bool enabled) {
+    q->read_your_writes = enabled;
+}
+
+void corm_query_timeout(corm_query_t* q, int ms) {
+    q->timeout_ms = ms;
+}
+
+void corm_query_cancel_token(corm_query_t* q, corm_cancel_token_t* token) {
+    q->cancel = token;
+}
+
+// Cancellation
+//
+// The flag is what stops a query: the backend's progress handler polls it
+// along with the deadline. A token also remembers the connection its query
+// is running on, so corm_cancel can interrupt that one right away instead
+// of waiting for the next poll. `lock` keeps the connection from moving on
+// to other work while it's being interrupted.
+struct corm_cancel_token_t {
+    int cancelled;
+    pthread_mutex_t lock;
+    corm_db_t* running;
+};
+
+corm_cancel_token_t* corm_cancel_token_create(void) {
+    corm_cancel_token_t* token = CORM_MALLOC(sizeof(corm_cancel_token_t));
+    if (!token) return NULL;
+
+    token->cancelled = 0;
+    token->running = NULL;
+    pthread_mutex_init(&token->lock, NULL);
+    return token;
+}
+
+void corm_cancel_token_destroy(corm_cancel_token_t* token) {
+    if (!token) return;
+    pthread_mutex_destroy(&token->lock);
+    CORM_FREE(token);
+}
+
+void corm_cancel(corm_cancel_token_t* token) {
+    if (!token) return;
+
+    __atomic_store_n(&token->cancelled, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&token->lock);
+    corm_db_t* conn = token->running;
+    if (conn && conn->backend->interrupt) {
+        conn->backend->interrupt(conn->backend_conn);
+    }
+    pthread_mutex_unlock(&token->lock);
+}
+
+void corm_cancel_token_reset(corm_cancel_token_t* token) {
+    if (token) __atomic_store_n(&token->cancelled, 0, __ATOMIC_RELEASE);
+}
+
+bool corm_cancel_requested(corm_cancel_token_t* token) {
+    return token && __atomic_load_n(&token->cancelled, __ATOMIC_ACQUIRE);
+}
+
+// Limits of one running query, armed on the connection that runs it
+typedef struct {
+    corm_db_t* conn;
+    corm_cancel_token_t* token;
+    uint64_t deadline_ns;
+    bool timed_out;
+    bool armed;
+} corm_watch_t;
+
+static int corm_watch_progress(void* ctx) {
+    corm_watch_t* watch = (corm_watch_t*)ctx;
+    if (corm_cancel_requested(watch->token)) return 1;
+    if (watch->deadline_ns && corm_now_ns() >= watch->deadline_ns) {
+        watch->timed_out = true;
+        return 1;
+    }
+    return 0;
+}
+
+// Returns false (with the error set on db) if the query can't start: the
+// token is already cancelled or the backend can't enforce the limits.
+static bool corm_watch_start(corm_db_t* db, corm_db_t* conn, corm_query_t* q, corm_watch_t* watch) {
+    memset(watch, 0, sizeof(*watch));
+    if (q->timeout_ms <= 0 && !q->cancel) return true;
+
+    if (corm_cancel_requested(q->cancel)) {
+        CORM_SET_ERROR_CODE(db, CORM_ERROR_CANCELLED, "Query cancelled");
+        return false;
+    }
+    if (!conn->backend->set_progress) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't support query timeouts or cancellation", conn->backend->name);
+        return false;
+    }
+
+    watch->conn = conn;
+    watch->token = q->cancel;
+    watch->deadline_ns = q->timeout_ms > 0 ? corm_now_ns() + (uint64_t)q->timeout_ms * 1000000ULL : 0;
+    watch->armed = true;
+    conn->backend->set_progress(conn->backend_conn, corm_watch_progress, watch);
+
+    if (watch->token) {
+        pthread_mutex_lock(&watch->token->lock);
+        watch->token->running = conn;
+        pthread_mutex_unlock(&watch->token->lock);
+    }
+    return true;
+}
+
+static void corm_watch_end(corm_watch_t* watch) {
+    if (!watch->armed) return;
+
+    if (watch->token) {
+        pthread_mutex_lock(&watch->token->lock);
+        watch->token->running = NULL;
+        pthread_mutex_unlock(&watch->token->lock);
+    }
+    watch->conn->backend->set_progress(watch->conn->backend_conn, NULL, NULL);
+    watch->armed = false;
+}
+
+// Sets the error for a statement that came back CORM_STEP_INTERRUPTED
+static void corm_watch_fail(corm_db_t* db, corm_watch_t* watch, int timeout_ms) {
+    if (watch->timed_out) {
+        CORM_SET_ERROR_CODE(db, CORM_ERROR_TIMEOUT, "Query timed out after %d ms", timeout_ms);
+    } else {
+        CORM_SET_ERROR_CODE(db, CORM_ERROR_CANCELLED, "Query cancelled");
+    }
+}
+
+// Queries from corm_query are used up by running them, caller-owned ones
+// stay with the caller
+static void corm_query_release(corm_query_t* q) {
+    if (!q->caller_owned) corm_free_fn(q->db, q);
+}
+
+// Queries are built against whatever handle the caller has and only bound to
+// the calling thread's connection when they run
+static bool corm_query_route(corm_query_t* q) {
+    corm_db_t* db = corm_route(q->db);
+    if (!db) {
+        corm_query_release(q);
+        return false;
+    }
+    q->db = db;
+    return true;
+}
+
+// Empties a result for another run of corm_query_exec_into. The rows array
+// is kept; strings and blobs start over in the last chunk, or in one twice
+// its size if the previous run outgrew the first.
+static void corm_result_recycle(corm_db_t* db, corm_result_t* res) {
+    if (res->snapshot) {
+        corm_untrack_result(db, res);
+        corm_free_fn(db, res->snapshot);
+        res->snapshot = NULL;
+    }
+
+    if (res->allocation_count > 1) {
+        size_t chunk_size = res->chunk_size * 2;
+        for (size_t i = 0; i < res->allocation_count; i++) {
+            corm_free_fn(db, res->allocations[i]);
+        }
+        res->allocation_count = 0;
+
+        res->chunk = corm_alloc_fn(db, chunk_size);
+        res->chunk_size = res->chunk ? chunk_size : 0;
+        if (res->chunk) res->allocations[res->allocation_count++] = res->chunk;
+    }
+    res->chunk_used = 0;
+    res->count = 0;
+}
+
+// Runs q on `conn`, which is either q->db itself or one of its readers.
+// Everything but the statement itself stays on q->db. With `reuse` the rows
+// go into that result, which is left empty on failure; without it a new one
+// is returned, or NULL when nothing matched.
+static corm_result_t* corm_query_exec_on(corm_query_t* q, corm_db_t* conn, corm_result_t* reuse) {
+    corm_db_t*    db   = q->db;
+    model_meta_t* meta = q->meta;
+
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_SELECT, meta);
+    corm_predicate_t where = { .kind = CORM_PRED_RAW, .sql = q->where_clause, .param = 1 };
+    req.where = q->where_clause ? &where : NULL;
+    req.order_by = q->order_by;
+    req.limit = q->limit;
+    req.offset = q->offset;
+
+    // decode_row reads columns by position, so spell them out in field order
+    if ((meta->decode_row && !corm_request_columns(db, &req, meta, 0)) ||
+        !corm_request_params(db, &req, q->param_types, q->param_count)) {
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+
+    // Queries are cached by shape, so running the same query again with
+    // other values doesn't prepare anything
+    uint64_t shape;
+    corm_string_t shape_text;
+    if (!corm_request_shape_text(db, &req, &shape, &shape_text)) {
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+    bool cached = true;
+    corm_backend_stmt_t stmt = corm_stmt_cache_get(conn, meta, CORM_STMT_QUERY, shape, &shape_text);
+    if (!stmt) {
+        if (!corm_prepare_request(db, conn->backend_conn, &req, &stmt, "query")) {
+            corm_query_release(q);
+            corm_arena_end_temp(tmp);
+            return NULL;
+        }
+        cached = corm_stmt_cache_put(conn, meta, CORM_STMT_QUERY, shape, &shape_text, stmt);
+    }
+
+    for (size_t i = 0; i < q->param_count; i++) {
+        if (!bind_param_by_type(db, stmt, (int)(i + 1), q->params[i], q->param_types[i])) {
+            CORM_SET_ERROR(db, "Failed to bind parameter %zu", i);
+            corm_stmt_release(db, stmt, cached);
+            corm_query_release(q);
+            corm_arena_end_temp(tmp);
+            return NULL;
+        }
+    }
+
+    int col_count = db->backend->column_count(stmt);
+    int* col_map = corm_arena_alloc(db->internal_arena, sizeof(int) * meta->field_count);
+    if (!col_map) {
+        CORM_SET_ERROR(db, "Failed to allocate column map");
+        corm_stmt_release(db, stmt, cached);
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+
+    for (uint64_t i = 0; i < meta->field_count; i++) {
+        col_map[i] = -1;
+        if (meta->fields[i].type == FIELD_TYPE_BELONGS_TO ||
+            meta->fields[i].type == FIELD_TYPE_HAS_MANY) continue;
+
+        for (int j = 0; j < col_count; j++) {
+            if (strcmp(db->backend->column_name(stmt, j), meta->fields[i].name) == 0) {
+                col_map[i] = j;
+                break;
+            }
+        }
+    }
+
+    corm_result_t* res = reuse;
+    if (res) {
+        corm_result_recycle(db, res);
+    } else {
+        res = corm_result_create(db, meta);
+        if (!res) CORM_SET_ERROR(db, "Failed to allocate result");
+    }
+    if (res && !res->data) {
+        res->data = corm_alloc_fn(db, meta->struct_size * 16);
+        res->capacity = res->data ? 16 : 0;
+        if (!res->data) CORM_SET_ERROR(db, "Failed to allocate instances array");
+    }
+    if (!res || !res->data) {
+        if (res && res != reuse) corm_free_result(db, res);
+        corm_stmt_release(db, stmt, cached);
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+
+    // Without a generated decoder, a backend that decodes whole rows fills
+    // the instances array a batch at a time
+    corm_plan_alloc_ctx_t alloc_ctx = { db, res, false };
+    corm_row_plan_t plan = { 0 };
+    if (!meta->decode_row && db->backend->fetch_rows) {
+        corm_column_plan_t* columns = corm_arena_alloc(db->internal_arena,
+                                                       sizeof(corm_column_plan_t) * meta->field_count);
+        size_t planned = 0;
+        for (uint64_t i = 0; columns && i < meta->field_count; i++) {
+            if (col_map[i] == -1) continue;
+            columns[planned].offset = meta->fields[i].offset;
+            columns[planned].type = meta->fields[i].type;
+            columns[planned].index = col_map[i];
+            planned++;
+        }
+        plan.columns = columns;
+        plan.count = planned;
+        plan.row_size = meta->struct_size;
+        plan.alloc = corm_plan_alloc;
+        plan.alloc_ctx = &alloc_ctx;
+    }
+
+    bool ok = true;
+    corm_watch_t watch;
+    if (!corm_watch_start(db, conn, q, &watch)) {
+        ok = false;
+    }
+
+    size_t count = 0;
+    int rc = CORM_STEP_DONE;
+    while (ok) {
+        if (count >= res->capacity) {
+            size_t new_cap = res->capacity * 2;
+            void* grown = corm_alloc_fn(db, meta->struct_size * new_cap);
+            if (!grown) {
+                CORM_SET_ERROR(db, "Failed to grow instances array");
+                ok = false;
+                break;
+            }
+            memcpy(grown, res->data, meta->struct_size * count);
+            corm_free_fn(db, res->data);
+            res->data = grown;
+            res->capacity = new_cap;
+        }
+
+        if (plan.columns) {
+            size_t room = res->capacity - count;
+            void* slots = (char*)res->data + (count * meta->struct_size);
+            memset(slots, 0, meta->struct_size * room);
+
+            int fetched = db->backend->fetch_rows(stmt, &plan, slots, (int)room);
+            corm_busy_t busy = { 0 };
+            while (corm_step_busy(fetched) && corm_busy_wait(db, &busy)) {
+                fetched = db->backend->fetch_rows(stmt, &plan, slots, (int)room);
+            }
+            if (fetched <= 0) {
+                rc = fetched;
+                break;
+            }
+            count += (size_t)fetched;
+            if ((size_t)fetched < room) break;
+            continue;
+        }
+
+        rc = corm_step(db, stmt);
+        if (rc != CORM_STEP_ROW) break;
+
+        void* inst = (char*)res->data + (count * meta->struct_size);
+        memset(inst, 0, meta->struct_size);
+
+        bool decoded = true;
+        if (meta->decode_row) {
+            decoded = meta->decode_row(db, res, stmt, inst);
+        } else {
+            for (uint64_t i = 0; decoded && i < meta->field_count; i++) {
+                if (col_map[i] == -1) continue;
+                void* field_ptr = (char*)inst + meta->fields[i].offset;
+                decoded = extract_field_from_column(db, res, stmt, col_map[i], field_ptr, meta->fields[i].type);
+            }
+        }
+        if (!decoded) {
+            CORM_SET_ERROR(db, "Failed to allocate column data");
+            ok = false;
+            break;
+        }
+
+        count++;
+    }
+
+    corm_watch_end(&watch);
+
+    // A failed step, or a fetch_rows that couldn't copy a column, ends the
+    // rows early; that is an error, not a short result
+    if (ok && alloc_ctx.failed) {
+        CORM_SET_ERROR(db, "Failed to allocate column data");
+        ok = false;
+    } else if (ok && rc < 0 && rc != CORM_STEP_INTERRUPTED) {
+        const char* backend_err = db->backend->get_error(conn->backend_conn);
+        CORM_SET_ERROR(db, "Failed to fetch rows: %s", backend_err ? backend_err : "unknown error");
+        ok = false;
+    }
+
+    bool track_changes = q->track_changes && corm_model_maskable(meta);
+    int timeout_ms = q->timeout_ms;
+
+    corm_stmt_release(db, stmt, cached);
+    corm_query_release(q);
+    corm_arena_end_temp(tmp);
+
+    res->count = (int)count;
+
+    if (rc == CORM_STEP_INTERRUPTED) {
+        corm_watch_fail(db, &watch, timeout_ms);
+        ok = false;
+    }
+
+    if (!ok || (count == 0 && !reuse)) {
+        if (res == reuse) {
+            corm_result_recycle(db, res);
+        } else {
+            corm_free_result(db, res);
+        }
+        return NULL;
+    }
+
+    if (track_changes && count > 0) {
+        res->snapshot = corm_alloc_fn(db, sizeof(uint64_t) * meta->field_count * count);
+        if (!res->snapshot) {
+            CORM_SET_ERROR(db, "Failed to allocate change tracking snapshot");
+            if (res == reuse) {
+                corm_result_recycle(db, res);
+            } else {
+                corm_free_result(db, res);
+            }
+            return NULL;
+        }
+        for (size_t i = 0; i < count; i++) {
+            corm_snapshot_row(meta, (char*)res->data + i * meta->struct_size,
+                              res->snapshot + i * meta->field_count);
+        }
+        corm_track_result(db, res);
+    }
+
+    return res;
+}
+
+// Picks the connection: a reader when there are some, unless the query has
+// to see this handle's own writes
+static corm_result_t* corm_query_run(corm_query_t* q, corm_result_t* reuse) {
+    corm_db_t* db = q->db;
+    corm_db_t* root = db->parent ? db->parent : db;
+
+    if (!root->readers || q->read_your_writes) {
+        if (q->read_your_writes && !corm_write_barrier(db)) {
+            corm_query_release(q);
+            return NULL;
+        }
+        return corm_query_exec_on(q, db, reuse);
+    }
+
+    corm_db_t* reader = corm_pool_checkout(root->readers);
+    corm_result_t* res = corm_query_exec_on(q, reader, reuse);
+    corm_pool_checkin(root->readers, reader);
+    return res;
+}
+
+corm_result_t* corm_query_exec(corm_query_t* q) {
+    if (!q) return NULL;
+    if (!corm_query_route(q)) return NULL;
+    return corm_query_run(q, NULL);
+}
+
+bool corm_query_exec_into(corm_query_t* q, corm_result_t** res) {
+    if (!q || !res) return false;
+    if (!corm_query_route(q)) return false;
+
+    corm_db_t* db = q->db;
+    if (*res && (*res)->meta != q->meta) {
+        CORM_SET_ERROR(db, "Result holds %s rows, not %s", (*res)->meta->table_name, q->meta->table_name);
+        corm_query_release(q);
+        return false;
+    }
+
+    // The first run gets an empty result to keep, even if nothing matched
+    if (!*res) {
+        *res = corm_result_create(db, q->meta);
+        if (!*res) {
+            CORM_SET_ERROR(db, "Failed to allocate result");
+            corm_query_release(q);
+            return false;
+        }
+    }
+    return corm_query_run(q, *res) != NULL;
+}
+
+corm_backend_stmt_t corm_select_prepare(corm_db_t* conn, model_meta_t* meta, const char* const* columns,
+                                        size_t column_count, const char* where,
+                                        const field_type_e* param_types, size_t param_count) {
+    if (!conn || !meta || (!columns && column_count > 0) || (!param_types && param_count > 0)) {
+        CORM_SET_ERROR(conn, "Invalid arguments to corm_select_prepare");
+        return NULL;
     }
-    if (pk_count > 1) {
-        CORM_SET_ERROR(db, "Model '%s' has %d PRIMARY_KEY fields, expected 1", meta->table_name, pk_count);
+
+    corm_temp_t tmp = corm_arena_start_temp(conn->internal_arena);
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_SELECT, meta);
+    corm_predicate_t by_where = { .kind = CORM_PRED_RAW, .sql = where, .param = 1 };
+    req.where = where ? &by_where : NULL;
+
+    corm_request_column_t* list = corm_arena_alloc(conn->internal_arena,
+                                                   sizeof(corm_request_column_t) * (column_count + 1));
+    bool ok = list != NULL;
+    for (size_t i = 0; ok && i < column_count; i++) {
+        field_info_t* field = corm_field_by_name(conn, meta, columns[i]);
+        if (!field || !corm_is_column(field)) {
+            CORM_SET_ERROR(conn, "Column '%s' doesn't exist in %s", columns[i], meta->table_name);
+            ok = false;
+            break;
+        }
+        list[i] = (corm_request_column_t){ field->name, field->type, false };
+    }
+    req.columns = list;
+    req.column_count = column_count;
+
+    // Same cache and shape as corm_query_exec, so equal selects share one
+    // statement. It's lent out until corm_select_release; a select whose
+    // statement is already lent gets a fresh one of its own.
+    corm_backend_stmt_t stmt = NULL;
+    uint64_t shape;
+    corm_string_t text;
+    if (ok && corm_request_params(conn, &req, param_types, param_count) &&
+        corm_request_shape_text(conn, &req, &shape, &text)) {
+        stmt = corm_stmt_cache_get(conn, meta, CORM_STMT_QUERY, shape, &text);
+        if (stmt && !corm_stmt_cache_lend(conn, meta, CORM_STMT_QUERY, shape, &text)) {
+            stmt = NULL;
+        }
+        if (!stmt && corm_prepare_request(conn, conn->backend_conn, &req, &stmt, "query") &&
+            corm_stmt_cache_can_lend(conn) &&
+            corm_stmt_cache_put(conn, meta, CORM_STMT_QUERY, shape, &text, stmt)) {
+            corm_stmt_cache_lend(conn, meta, CORM_STMT_QUERY, shape, &text);
+        }
+    }
+
+    corm_arena_end_temp(tmp);
+    return stmt;
+}
+
+void corm_select_release(corm_db_t* conn, corm_backend_stmt_t stmt) {
+    if (!conn || !stmt) return;
+    corm_stmt_release(conn, stmt, corm_stmt_cache_return(conn, stmt));
+}
+
+bool corm_delete(corm_db_t* db, model_meta_t* meta, void* pk_value) {
+    db = corm_route(db);
+    if (!db) return false;
+
+    if (!meta || !pk_value) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_delete");
         return false;
     }
     
-    meta->primary_key_field = pk_field;
+    if (!meta->primary_key_field) {
+        CORM_SET_ERROR(db, "Model '%s' has no primary key", meta->table_name);
+        return false;
+    }
+    
+    if (!corm_write_barrier(db)) {
+        return false;
+    }
+
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+    
+    corm_request_t req = corm_request_init(CORM_REQUEST_DELETE, meta);
+    corm_predicate_t by_pk = { .kind = CORM_PRED_CMP, .column = meta->primary_key_field->name,
+                               .cmp = CORM_CMP_EQ, .param = 1 };
+    req.where = &by_pk;
 
-    if (db->model_count >= db->model_capacity) {
-        CORM_SET_ERROR(db, "Maximum number of models (%d) reached. Define CORM_MAX_MODELS to increase.",
-                     (int)db->model_capacity);
+    corm_backend_stmt_t stmt;
+    if (!corm_request_params(db, &req, &meta->primary_key_field->type, 1) ||
+        !corm_prepare_request(db, db->backend_conn, &req, &stmt, "DELETE")) {
+        corm_arena_end_temp(tmp);
+        return false;
+    }
+    
+    if (!bind_param_by_type(db, stmt, 1, pk_value, meta->primary_key_field->type)) {
+        CORM_SET_ERROR(db, "Failed to bind primary key");
+        db->backend->finalize(stmt);
+        corm_arena_end_temp(tmp);
+        return false;
+    }
+    
+    int result = corm_step(db, stmt);
+    db->backend->finalize(stmt);
+    corm_arena_end_temp(tmp);
+    
+    if (result < 0) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to execute DELETE: %s", backend_err ? backend_err : "unknown error");
         return false;
     }
     
-    db->models[db->model_count++] = meta;
     return true;
 }
 
-static bool extract_field_from_column(corm_db_t* db, corm_result_t* result,
-                                      corm_backend_stmt_t stmt, int col_idx,
-                                      void* field_ptr, field_type_e type) {
-    if (db->backend->column_type(stmt, col_idx) == 0) {
-        return true;
+// Runs an UPDATE or DELETE request restricted by a query's WHERE clause.
+// The request's columns take set_values, the query's own parameters follow.
+// Consumes q.
+static int64_t corm_exec_where(corm_query_t* q, corm_request_t* req, void** set_values) {
+    corm_db_t* db = q->db;
+    const char* verb = req->op == CORM_REQUEST_UPDATE ? "UPDATE" : "DELETE";
+
+    if (q->order_by || q->limit != -1 || q->offset > 0) {
+        CORM_SET_ERROR(db, "ORDER BY, LIMIT and OFFSET are not supported for %s", verb);
+        corm_query_release(q);
+        return -1;
     }
-    
+    if (!corm_write_barrier(db)) {
+        corm_query_release(q);
+        return -1;
+    }
+
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    size_t set_count = req->column_count;
+    corm_predicate_t where = { .kind = CORM_PRED_RAW, .sql = q->where_clause, .param = (int)set_count + 1 };
+    req->where = q->where_clause ? &where : NULL;
+
+    corm_backend_stmt_t stmt;
+    if (!corm_request_params(db, req, q->param_types, q->param_count) ||
+        !corm_prepare_request(db, db->backend_conn, req, &stmt, verb)) {
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return -1;
+    }
+
+    int param_idx = 1;
+    for (size_t i = 0; i < set_count; i++, param_idx++) {
+        if (!bind_param_by_type(db, stmt, param_idx, set_values[i], req->columns[i].type)) {
+            CORM_SET_ERROR(db, "Failed to bind parameter %d", param_idx);
+            db->backend->finalize(stmt);
+            corm_query_release(q);
+            corm_arena_end_temp(tmp);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < q->param_count; i++, param_idx++) {
+        if (!bind_param_by_type(db, stmt, param_idx, q->params[i], q->param_types[i])) {
+            CORM_SET_ERROR(db, "Failed to bind parameter %d", param_idx);
+            db->backend->finalize(stmt);
+            corm_query_release(q);
+            corm_arena_end_temp(tmp);
+            return -1;
+        }
+    }
+
+    int64_t affected = -1;
+    corm_watch_t watch;
+    if (corm_watch_start(db, db, q, &watch)) {
+        int rc = corm_step(db, stmt);
+        corm_watch_end(&watch);
+
+        if (rc == CORM_STEP_INTERRUPTED) {
+            corm_watch_fail(db, &watch, q->timeout_ms);
+        } else if (rc < 0) {
+            const char* backend_err = db->backend->get_error(db->backend_conn);
+            CORM_SET_ERROR(db, "Failed to execute %s: %s", verb, backend_err ? backend_err : "unknown error");
+        } else {
+            affected = db->backend->changes(db->backend_conn);
+        }
+    }
+
+    db->backend->finalize(stmt);
+    corm_query_release(q);
+    corm_arena_end_temp(tmp);
+    return affected;
+}
+
+int64_t corm_delete_where(corm_query_t* q) {
+    if (!q) return -1;
+    if (!corm_query_route(q)) return -1;
+
+    corm_db_t* db = q->db;
+    if (!db->backend->changes) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't report affected rows", db->backend->name);
+        corm_query_release(q);
+        return -1;
+    }
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_DELETE, q->meta);
+    return corm_exec_where(q, &req, NULL);
+}
+
+int64_t corm_update_where(corm_query_t* q, const char** fields, void** values,
+                          field_type_e* types, size_t count) {
+    if (!q) return -1;
+    if (!corm_query_route(q)) return -1;
+
+    corm_db_t*    db   = q->db;
+    model_meta_t* meta = q->meta;
+
+    if (!db->backend->changes) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't report affected rows", db->backend->name);
+        corm_query_release(q);
+        return -1;
+    }
+    if (count == 0) {
+        CORM_SET_ERROR(db, "No fields given for %s", meta->table_name);
+        corm_query_release(q);
+        return -1;
+    }
+
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_UPDATE, meta);
+    corm_request_column_t* columns = corm_arena_alloc(db->internal_arena, sizeof(corm_request_column_t) * count);
+    if (!columns) {
+        corm_query_release(q);
+        corm_arena_end_temp(tmp);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        field_info_t* field = corm_field_by_name(db, meta, fields[i]);
+        if (!field || !corm_is_column(field)) {
+            CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", fields[i], meta->table_name);
+            corm_query_release(q);
+            corm_arena_end_temp(tmp);
+            return -1;
+        }
+
+        // Typed by the values given, which is what gets bound
+        columns[i].name = field->name;
+        columns[i].type = types[i];
+    }
+    req.columns = columns;
+    req.column_count = count;
+
+    int64_t affected = corm_exec_where(q, &req, values);
+    corm_arena_end_temp(tmp);
+    return affected;
+}
+
+static size_t corm_field_type_size(field_type_e type) {
     switch (type) {
+        case FIELD_TYPE_INT:    return sizeof(int);
+        case FIELD_TYPE_INT64:  return sizeof(int64_t);
+        case FIELD_TYPE_FLOAT:  return sizeof(float);
+        case FIELD_TYPE_DOUBLE: return sizeof(double);
+        case FIELD_TYPE_STRING: return sizeof(char*);
+        case FIELD_TYPE_BOOL:   return sizeof(bool);
+        case FIELD_TYPE_BLOB:   return sizeof(blob_t);
+        default:                return 0;
+    }
+}
+
+static corm_backend_stmt_t corm_prepare_delete_many(corm_db_t* db, model_meta_t* meta, size_t count) {
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    corm_request_t req = corm_request_init(CORM_REQUEST_DELETE, meta);
+    corm_predicate_t by_pks = { .kind = CORM_PRED_IN, .column = meta->primary_key_field->name,
+                                .param = 1, .count = (int)count };
+    req.where = &by_pks;
+
+    corm_backend_stmt_t stmt = NULL;
+    field_type_e* types = corm_arena_alloc(db->internal_arena, sizeof(field_type_e) * count);
+    if (types) {
+        for (size_t i = 0; i < count; i++) types[i] = meta->primary_key_field->type;
+        if (corm_request_params(db, &req, types, count)) {
+            corm_prepare_request(db, db->backend_conn, &req, &stmt, "DELETE");
+        }
+    }
+
+    corm_arena_end_temp(tmp);
+    return stmt;
+}
+
+int64_t corm_delete_many(corm_db_t* db, model_meta_t* meta, const void* pks, size_t count) {
+    db = corm_route(db);
+    if (!db) return -1;
+
+    if (!meta || (!pks && count > 0)) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_delete_many");
+        return -1;
+    }
+
+    field_info_t* pk_field = meta->primary_key_field;
+    if (!pk_field) {
+        CORM_SET_ERROR(db, "Model '%s' has no primary key", meta->table_name);
+        return -1;
+    }
+    if (!db->backend->changes) {
+        CORM_SET_ERROR(db, "Backend '%s' doesn't report affected rows", db->backend->name);
+        return -1;
+    }
+    if (count == 0) return 0;
+    if (!corm_write_barrier(db)) {
+        return -1;
+    }
+
+    size_t stride = corm_field_type_size(pk_field->type);
+    bool chunked = count > CORM_DELETE_MANY_CHUNK;
+    if (chunked && !db->backend->begin_transaction(db->backend_conn)) {
+        const char* backend_err = db->backend->get_error(db->backend_conn);
+        CORM_SET_ERROR(db, "Failed to begin transaction: %s", backend_err ? backend_err : "unknown error");
+        return -1;
+    }
+
+    int64_t total = 0;
+    for (size_t done = 0; done < count; ) {
+        size_t n = count - done;
+        if (n > CORM_DELETE_MANY_CHUNK) n = CORM_DELETE_MANY_CHUNK;
+
+        // Only two shapes ever show up: full chunks and the remainder
+        bool cached = true;
+        corm_backend_stmt_t stmt = corm_stmt_cache_get(db, meta, CORM_STMT_DELETE_MANY, n, NULL);
+        if (!stmt) {
+            stmt = corm_prepare_delete_many(db, meta, n);
+            if (!stmt) {
+                total = -1;
+                break;
+            }
+            cached = corm_stmt_cache_put(db, meta, CORM_STMT_DELETE_MANY, n, NULL, stmt);
+        }
+
+        bool ok = true;
+        for (size_t i = 0; i < n && ok; i++) {
+            void* pk_value = (char*)pks + (done + i) * stride;
+            if (!bind_param_by_type(db, stmt, (int)i + 1, pk_value, pk_field->type)) {
+                CORM_SET_ERROR(db, "Failed to bind primary key");
+                ok = false;
+            }
+        }
+
+        if (ok && corm_step(db, stmt) < 0) {
+            const char* backend_err = db->backend->get_error(db->backend_conn);
+            CORM_SET_ERROR(db, "Failed to execute DELETE: %s", backend_err ? backend_err : "unknown error");
+            ok = false;
+        }
+        if (ok) {
+            total += db->backend->changes(db->backend_conn);
+        }
+
+        corm_stmt_release(db, stmt, cached);
+
+        if (!ok) {
+            total = -1;
+            break;
+        }
+        done += n;
+    }
+
+    if (chunked) {
+        if (total < 0) {
+            db->backend->rollback(db->backend_conn);
+        } else if (!db->backend->commit(db->backend_conn)) {
+            const char* backend_err = db->backend->get_error(db->backend_conn);
+            CORM_SET_ERROR(db, "Failed to commit transaction: %s", backend_err ? backend_err : "unknown error");
+            db->backend->rollback(db->backend_conn);
+            total = -1;
+        }
+    }
+    return total;
+}
+
+static corm_result_t* corm_load_belongs_to(corm_db_t* db, void* instance, field_info_t* field) {
+    field_info_t* fk_field = field->fk_field;
+    if (!field->related_model || !fk_field) {
+        CORM_SET_ERROR(db, "Related model not resolved for field '%s', call corm_sync first", field->name);
+        return NULL;
+    }
+    
+    void* fk_value_ptr = (char*)instance + fk_field->offset;
+    
+    bool is_null = false;
+    switch (fk_field->type) {
         case FIELD_TYPE_INT:
-            *(int*)field_ptr = db->backend->column_int(stmt, col_idx);
+            is_null = (*(int*)fk_value_ptr == 0);
             break;
-        
         case FIELD_TYPE_BOOL:
-            *(bool*)field_ptr = db->backend->column_int(stmt, col_idx) != 0;
+            is_null = (*(bool*)fk_value_ptr == 0);
             break;
-            
         case FIELD_TYPE_INT64:
-            *(int64_t*)field_ptr = db->backend->column_int64(stmt, col_idx);
-            break;
-            
-        case FIELD_TYPE_FLOAT:
-            *(float*)field_ptr = (float)db->backend->column_double(stmt, col_idx);
-            break;
-            
-        case FIELD_TYPE_DOUBLE:
-            *(double*)field_ptr = db->backend->column_double(stmt, col_idx);
-            break;
-            
-        case FIELD_TYPE_STRING: {
-            const char* text = (const char*)db->backend->column_text(stmt, col_idx);
-            if (text) {
-                size_t len = strlen(text);
-                char* str = corm_result_alloc(db, result, len + 1);
-                if (str) {
-                    memcpy(str, text, len + 1);
-                    *(char**)field_ptr = str;
-                }
-            }
+            is_null = (*(int64_t*)fk_value_ptr == 0);
             break;
-        }
-        
-        case FIELD_TYPE_BLOB: {
-            const void* blob_data = db->backend->column_blob(stmt, col_idx);
-            int blob_size = db->backend->column_bytes(stmt, col_idx);
-            if (blob_data && blob_size > 0) {
-                void* data = corm_result_alloc(db, result, blob_size);
-                if (data) {
-                    memcpy(data, blob_data, blob_size);
-                    ((blob_t*)field_ptr)->data = data;
-                    ((blob_t*)field_ptr)->size = blob_size;
-                }
-            }
+        case FIELD_TYPE_STRING:
+            is_null = (*(char**)fk_value_ptr == NULL);
             break;
-        }
-        
         default:
-            return false;
+            break;
+    }
+    
+    if (is_null) {
+        void* relation_ptr = (char*)instance + field->offset;
+        *(void**)relation_ptr = NULL;
+        return NULL;
+    }
+    
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    const char* placeholder = db->backend->get_placeholder(1);
+    corm_string_t where = corm_str_fmt(db->internal_arena, "%s = %s",
+                                       field->related_model->primary_key_field->name,
+                                       placeholder);
+
+    void* params[]          = { fk_value_ptr };
+    field_type_e types[]    = { fk_field->type };
+
+    corm_query_t* q = corm_query(db, field->related_model);
+    if (!q) {
+        corm_arena_end_temp(tmp);
+        return NULL;
+    }
+
+    corm_query_where(q, (const char*)where.str, params, types, 1);
+    corm_result_t* related_result = corm_query_exec(q);
+
+    corm_arena_end_temp(tmp);
+
+    if (!related_result) {
+        return NULL;
+    }
+
+    void* relation_ptr = (char*)instance + field->offset;
+    *(void**)relation_ptr = related_result->data;
+
+    return related_result;
+}
+
+static corm_result_t* corm_load_has_many(corm_db_t* db, void* instance, model_meta_t* meta,
+										field_info_t* field) {
+    
+    if (!field->related_model) {
+        CORM_SET_ERROR(db, "Related model not resolved for field '%s'", field->name);
+        return NULL;
+    }
+    
+    void* pk_value = (char*)instance + meta->primary_key_field->offset;
+
+    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+
+    const char* placeholder = db->backend->get_placeholder(1);
+    corm_string_t where = corm_str_fmt(db->internal_arena, "%s = %s",
+                                       field->fk_column_name, placeholder);
+
+    void* params[]          = { pk_value };
+    field_type_e types[]    = { meta->primary_key_field->type };
+
+    corm_query_t* q = corm_query(db, field->related_model);
+    if (!q) {
+        corm_arena_end_temp(tmp);
+        *(void**)((char*)instance + field->offset)          = NULL;
+        *(int*)((char*)instance + field->count_offset)      = 0;
+        return NULL;
+    }
+
+    corm_query_where(q, (const char*)where.str, params, types, 1);
+    corm_result_t* result = corm_query_exec(q);
+
+    corm_arena_end_temp(tmp);
+    
+    void* relation_ptr = (char*)instance + field->offset;
+	void* count_ptr = (char*)instance + field->count_offset;
+
+	if (result) {
+        *(void**)relation_ptr = result->data;
+        *(int*)count_ptr = result->count;
+    } else {
+        *(void**)relation_ptr = NULL;
+        *(int*)count_ptr = 0;
     }
     
-    return true;
+    return result;
 }
 
-static bool bind_param_by_type(corm_db_t* db, corm_backend_stmt_t stmt, int param_idx,
-                                void* value_ptr, field_type_e type) {
-    switch (type) {
-        case FIELD_TYPE_INT:
-            return db->backend->bind_int(stmt, param_idx, *(int*)value_ptr);
-            
-        case FIELD_TYPE_BOOL:
-            return db->backend->bind_int(stmt, param_idx, *(bool*)value_ptr ? 1 : 0);
-            
-        case FIELD_TYPE_INT64:
-            return db->backend->bind_int64(stmt, param_idx, *(int64_t*)value_ptr);
-            
-        case FIELD_TYPE_FLOAT:
-            return db->backend->bind_double(stmt, param_idx, (double)(*(float*)value_ptr));
-            
-        case FIELD_TYPE_DOUBLE:
-            return db->backend->bind_double(stmt, param_idx, *(double*)value_ptr);
-            
-        case FIELD_TYPE_STRING: {
-            char* str = *(char**)value_ptr;
-            if (str) {
-                return db->backend->bind_string(stmt, param_idx, str, -1);
-            } else {
-                return db->backend->bind_null(stmt, param_idx);
-            }
-        }
-        
-        case FIELD_TYPE_BLOB: {
-            blob_t* blob = (blob_t*)value_ptr;
-            if (blob->data && blob->size > 0) {
-                return db->backend->bind_blob(stmt, param_idx, blob->data, blob->size);
-            } else {
-                return db->backend->bind_null(stmt, param_idx);
-            }
-        }
-        
-        default:
-            CORM_SET_ERROR(db, "Unsupported field type for binding");
-            return false;
+corm_result_t* corm_load_relation(corm_db_t* db, model_meta_t* meta, void* instance, const char* field_name) {
+    db = corm_route(db);
+    if (!db) return NULL;
+
+    field_info_t* field = corm_field_by_name(db, meta, field_name);
+    if (!field) {
+        CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", field_name, meta->table_name);
+        return NULL;
+    }
+    
+    if (field->type == FIELD_TYPE_BELONGS_TO) {
+        return corm_load_belongs_to(db, instance, field);
+    } else if (field->type == FIELD_TYPE_HAS_MANY) {
+        return corm_load_has_many(db, instance, meta, field);
     }
+    
+    return NULL;
 }
 
-static bool corm_resolve_relationships(corm_db_t* db) {
-    for (size_t i = 0; i < db->model_count; i++) {
-        model_meta_t* model = db->models[i];
-        
-        for (size_t j = 0; j < model->field_count; j++) {
-            field_info_t* field = &model->fields[j];
-            
-            if (field->type == FIELD_TYPE_BELONGS_TO || 
-                field->type == FIELD_TYPE_HAS_MANY) {
-                
-                field->related_model = NULL;
-                for (size_t k = 0; k < db->model_count; k++) {
-                    if (strcmp(db->models[k]->table_name, 
-                              field->target_model_name) == 0) {
-                        field->related_model = db->models[k];
-                        break;
-                    }
-                }
-                
-                if (!field->related_model) {
-                    CORM_SET_ERROR(db, "Related model '%s' not found for field '%s'",
-                             field->target_model_name, field->name);
-                    return false;
-                }
+void corm_free_result(corm_db_t* db, corm_result_t* result) {
+    db = corm_route(db);
+    if (!db) return;
+
+    if (!result) return;
+
+    if (result->snapshot) {
+        corm_untrack_result(db, result);
+        corm_free_fn(db, result->snapshot);
+    }
+    
+	if (result->allocations) {
+        for (size_t i = 0; i < result->allocation_count; i++) {
+            if (result->allocations[i]) {
+                corm_free_fn(db, result->allocations[i]);
             }
         }
+        corm_free_fn(db, result->allocations);
+    }
+    
+	if (result->data) {
+        corm_free_fn(db, result->data);
     }
-    return true;
-}
 
-static bool corm_table_exists(corm_db_t* db, const char* table_name) {
-    return db->backend->table_exists(db->backend_conn, table_name);
+    corm_free_fn(db, result);
 }
 
-static bool corm_record_exists(corm_db_t* db, model_meta_t* meta, field_info_t* pk_field, void* pk_value) {
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
-    
-    const char* placeholder = db->backend->get_placeholder(1);
-    corm_string_t sql = corm_str_fmt(db->internal_arena, "SELECT COUNT(*) FROM %s WHERE %s = %s;", 
-                          meta->table_name, pk_field->name, placeholder);
-    
-    corm_backend_stmt_t stmt;
+// Batched writes
+//
+// Writes queued by other threads run inside one transaction on a dedicated
+// connection. Each one gets its own savepoint so a failing write only rolls
+// back itself and the rest of the batch still commits.
+typedef enum {
+    CORM_OP_SAVE,
+    CORM_OP_DELETE,
+} corm_op_kind_e;
+
+static bool corm_run_batched_op(corm_db_t* db, corm_op_kind_e kind, model_meta_t* meta, void* target) {
     char* error = NULL;
-    if (!db->backend->prepare(db->backend_conn, &stmt, corm_str_to_c_safe(db->internal_arena, sql), &error)) {
-        CORM_SET_ERROR(db, "Failed to prepare statement: %s", error ? error : "unknown");
+    if (!db->backend->execute(db->backend_conn, "SAVEPOINT corm_op;", &error)) {
+        CORM_SET_ERROR(db, "Failed to create savepoint: %s", error ? error : "unknown error");
         if (error) free(error);
-        corm_arena_end_temp(tmp);
         return false;
     }
-    
-    if (!bind_param_by_type(db, stmt, 1, pk_value, pk_field->type)) {
-        db->backend->finalize(stmt);
-        corm_arena_end_temp(tmp);
-        return false;
+
+    bool ok = kind == CORM_OP_SAVE ? corm_save(db, meta, target) : corm_delete(db, meta, target);
+
+    if (!ok) {
+        db->backend->execute(db->backend_conn, "ROLLBACK TO corm_op;", NULL);
     }
-    
-    bool exists = false;
-    if (db->backend->step(stmt) == 1) {
-        exists = db->backend->column_int(stmt, 0) > 0;
+    db->backend->execute(db->backend_conn, "RELEASE corm_op;", NULL);
+    return ok;
+}
+
+static void corm_copy_error(corm_db_t* db, char* error, size_t error_size) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s", db->last_error);
     }
-    
-    db->backend->finalize(stmt);
-    corm_arena_end_temp(tmp);
-    return exists;
 }
 
-static corm_string_t corm_generate_create_table_sql(corm_db_t* db, model_meta_t* meta) {
-    corm_string_t sql = corm_str_fmt(db->internal_arena, "CREATE TABLE IF NOT EXISTS %s (", meta->table_name);
-    
-    bool first = true;
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        field_info_t* field = &meta->fields[i];
-        
-        if (field->type == FIELD_TYPE_BELONGS_TO || field->type == FIELD_TYPE_HAS_MANY) {
-            continue;
+// Group commit
+typedef struct corm_group_op_t {
+    corm_op_kind_e kind;
+    model_meta_t* meta;
+    void* target;
+
+    bool done;
+    bool ok;
+    char* error;
+    size_t error_size;
+
+    struct corm_group_op_t* next;
+} corm_group_op_t;
+
+struct corm_group_commit_t {
+    corm_db_t* writer;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+
+    corm_group_op_t* head;
+    corm_group_op_t* tail;
+    size_t pending;
+
+    uint32_t window_us;
+    size_t max_batch;
+    bool running;
+};
+
+static void corm_group_commit_run(corm_group_commit_t* gc, corm_group_op_t* batch) {
+    corm_db_t* writer = gc->writer;
+
+    if (!writer->backend->begin_transaction(writer->backend_conn)) {
+        const char* backend_err = writer->backend->get_error(writer->backend_conn);
+        CORM_SET_ERROR(writer, "Failed to begin transaction: %s", backend_err ? backend_err : "unknown error");
+        for (corm_group_op_t* op = batch; op; op = op->next) {
+            op->ok = false;
+            corm_copy_error(writer, op->error, op->error_size);
         }
-        
-        if (!first) {
-            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(", "));
+        return;
+    }
+
+    for (corm_group_op_t* op = batch; op; op = op->next) {
+        op->ok = corm_run_batched_op(writer, op->kind, op->meta, op->target);
+        if (!op->ok) {
+            corm_copy_error(writer, op->error, op->error_size);
         }
-        
-        char type_buf[128];
-        const char* type_name = db->backend->get_type_name(field->type, field->max_length, type_buf, sizeof(type_buf));
-        corm_string_t col_def = corm_str_fmt(db->internal_arena, "%s %s", field->name, type_name);
-        sql = corm_str_cat(db->internal_arena, sql, col_def);
-        
-        if (field->flags & PRIMARY_KEY) {
-            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" PRIMARY KEY"));
-            if (field->flags & AUTO_INC) {
-                const char* auto_inc = db->backend->get_auto_increment();
-                if (auto_inc && strlen(auto_inc) > 0) {
-                    corm_string_t auto_inc_str = corm_str_fmt(db->internal_arena, " %s", auto_inc);
-                    sql = corm_str_cat(db->internal_arena, sql, auto_inc_str);
-                }
+    }
+
+    if (!writer->backend->commit(writer->backend_conn)) {
+        const char* backend_err = writer->backend->get_error(writer->backend_conn);
+        CORM_SET_ERROR(writer, "Failed to commit batch: %s", backend_err ? backend_err : "unknown error");
+        writer->backend->rollback(writer->backend_conn);
+        for (corm_group_op_t* op = batch; op; op = op->next) {
+            op->ok = false;
+            corm_copy_error(writer, op->error, op->error_size);
+        }
+    }
+}
+
+static void* corm_group_commit_main(void* arg) {
+    corm_group_commit_t* gc = (corm_group_commit_t*)arg;
+
+    pthread_mutex_lock(&gc->lock);
+    for (;;) {
+        while (!gc->head && gc->running) {
+            pthread_cond_wait(&gc->work_cond, &gc->lock);
+        }
+        if (!gc->head) break;
+
+        // Give other writers a moment to join the batch
+        if (gc->running && gc->pending < gc->max_batch && gc->window_us > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            uint64_t nsec = (uint64_t)deadline.tv_nsec + (uint64_t)gc->window_us * 1000ULL;
+            deadline.tv_sec += (time_t)(nsec / 1000000000ULL);
+            deadline.tv_nsec = (long)(nsec % 1000000000ULL);
+
+            while (gc->running && gc->pending < gc->max_batch) {
+                if (pthread_cond_timedwait(&gc->work_cond, &gc->lock, &deadline) != 0) break;
             }
         }
-        
-        if (field->flags & NOT_NULL) {
-            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" NOT NULL"));
+
+        corm_group_op_t* batch = gc->head;
+        corm_group_op_t* last = batch;
+        size_t taken = 1;
+        while (last->next && taken < gc->max_batch) {
+            last = last->next;
+            taken++;
         }
-        
-        if (field->flags & UNIQUE) {
-            sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(" UNIQUE"));
+        gc->head = last->next;
+        if (!gc->head) gc->tail = NULL;
+        gc->pending -= taken;
+        last->next = NULL;
+
+        pthread_mutex_unlock(&gc->lock);
+        corm_group_commit_run(gc, batch);
+        pthread_mutex_lock(&gc->lock);
+
+        for (corm_group_op_t* op = batch; op; ) {
+            corm_group_op_t* next = op->next;
+            op->done = true;
+            op = next;
         }
-        
-        first = false;
+        pthread_cond_broadcast(&gc->done_cond);
     }
-    
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        field_info_t* field = &meta->fields[i];
+    pthread_mutex_unlock(&gc->lock);
+    return NULL;
+}
 
-        if (field->type == FIELD_TYPE_BELONGS_TO) {
-            corm_string_t fk = corm_str_fmt(db->internal_arena, ", FOREIGN KEY (%s) REFERENCES %s(%s)",
-                field->fk_column_name,
-                field->target_model_name,
-                field->related_model->primary_key_field->name
-            );
-            
-            switch(field->on_delete) {
-                case FK_CASCADE:
-                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE CASCADE"));
-                    break;
-                case FK_SET_NULL:
-                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE SET NULL"));
-                    break;
-                case FK_RESTRICT:
-                    fk = corm_str_cat(db->internal_arena, fk, CORM_STR_LIT(" ON DELETE RESTRICT"));
-                    break;
-                default: break;
-            }
-            
-            sql = corm_str_cat(db->internal_arena, sql, fk);
-        }
+corm_group_commit_t* corm_group_commit_start(corm_db_t* db, uint32_t window_us, size_t max_batch) {
+    if (!db || max_batch == 0) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_group_commit_start");
+        return NULL;
     }
-    
-    sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(");"));
-    return sql;
+
+    corm_group_commit_t* gc = CORM_MALLOC(sizeof(corm_group_commit_t));
+    if (!gc) {
+        CORM_SET_ERROR(db, "Failed to allocate group commit coordinator");
+        return NULL;
+    }
+    memset(gc, 0, sizeof(*gc));
+
+    gc->writer = corm_open_sibling(db);
+    if (!gc->writer) {
+        CORM_FREE(gc);
+        return NULL;
+    }
+
+    gc->window_us = window_us;
+    gc->max_batch = max_batch;
+    gc->running = true;
+    pthread_mutex_init(&gc->lock, NULL);
+    pthread_cond_init(&gc->work_cond, NULL);
+    pthread_cond_init(&gc->done_cond, NULL);
+
+    if (pthread_create(&gc->thread, NULL, corm_group_commit_main, gc) != 0) {
+        CORM_SET_ERROR(db, "Failed to start group commit thread");
+        pthread_cond_destroy(&gc->done_cond);
+        pthread_cond_destroy(&gc->work_cond);
+        pthread_mutex_destroy(&gc->lock);
+        corm_close(gc->writer);
+        CORM_FREE(gc);
+        return NULL;
+    }
+    return gc;
 }
 
-bool corm_sync(corm_db_t* db, corm_sync_mode_e mode) {
-    if (!corm_resolve_relationships(db)) {
+void corm_group_commit_stop(corm_group_commit_t* gc) {
+    if (!gc) return;
+
+    pthread_mutex_lock(&gc->lock);
+    gc->running = false;
+    pthread_cond_signal(&gc->work_cond);
+    pthread_mutex_unlock(&gc->lock);
+
+    // Whatever was queued still gets written before the thread exits
+    pthread_join(gc->thread, NULL);
+
+    pthread_cond_destroy(&gc->done_cond);
+    pthread_cond_destroy(&gc->work_cond);
+    pthread_mutex_destroy(&gc->lock);
+    corm_close(gc->writer);
+    CORM_FREE(gc);
+}
+
+static bool corm_group_submit(corm_group_commit_t* gc, corm_op_kind_e kind, model_meta_t* meta,
+                              void* target, char* error, size_t error_size) {
+    corm_group_op_t op = {
+        .kind = kind,
+        .meta = meta,
+        .target = target,
+        .error = error,
+        .error_size = error_size,
+    };
+
+    pthread_mutex_lock(&gc->lock);
+    if (!gc->running) {
+        pthread_mutex_unlock(&gc->lock);
+        if (error && error_size > 0) snprintf(error, error_size, "Group commit coordinator is stopped");
         return false;
     }
 
-    switch(mode) {
-        case CORM_SYNC_SAFE:
-        {
-            for (uint64_t i = 0; i < db->model_count; ++i) {
-                model_meta_t* meta = db->models[i];
-                bool existed = corm_table_exists(db, meta->table_name);
-                if (!existed) {
-                    corm_string_t create_sql = corm_generate_create_table_sql(db, meta);
-                    char* error = NULL;
-                    if (!db->backend->execute(db->backend_conn, corm_str_to_c_safe(db->internal_arena, create_sql), &error)) {
-                        CORM_SET_ERROR(db, "Failed to create table %s: %s", meta->table_name, error ? error : "unknown error");
-                        if (error) free(error);
-                        return false;
-                    }
-                }
-            }
-        }
-        break;
-        
-        case CORM_SYNC_DROP:
-        {
-            db->backend->set_foreign_keys(db->backend_conn, false);
-            
-            for (uint64_t i = 0; i < db->model_count; ++i) {
-                corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
-                corm_string_t drop_sql = corm_str_fmt(db->internal_arena, "DROP TABLE IF EXISTS %s;", 
-                                           db->models[i]->table_name);
-                char* error = NULL;
-                if (!db->backend->execute(db->backend_conn, corm_str_to_c_safe(db->internal_arena, drop_sql), &error)) {
-                    CORM_SET_ERROR(db, "Failed to drop table '%s': %s", db->models[i]->table_name, error ? error : "unknown");
-                    if (error) free(error);
-                    corm_arena_end_temp(tmp);
-                    return false;
-                }
-                corm_arena_end_temp(tmp);
-            }
-            
-            db->backend->set_foreign_keys(db->backend_conn, true);
-
-            for (uint64_t i = 0; i < db->model_count; ++i) {
-                corm_string_t create_sql = corm_generate_create_table_sql(db, db->models[i]);
-                char* error = NULL;
-                if (!db->backend->execute(db->backend_conn, corm_str_to_c_safe(db->internal_arena, create_sql), &error)) {
-                    CORM_SET_ERROR(db, "Failed to create table %s: %s", db->models[i]->table_name, error ? error : "unknown error");
-                    if (error) free(error);
-                    return false;
-                }
-            }
-        }
-        break;
-        
-        case CORM_SYNC_MIGRATE:
-        {
-            CORM_SET_ERROR(db, "CORM_SYNC_MIGRATE is not implemented yet");
-            return false;
+    if (gc->tail) {
+        gc->tail->next = &op;
+    } else {
+        gc->head = &op;
+    }
+    gc->tail = &op;
+    gc->pending++;
+    if (gc->pending == 1 || gc->pending >= gc->max_batch) {
+        pthread_cond_signal(&gc->work_cond);
+    }
+
+    while (!op.done) {
+        pthread_cond_wait(&gc->done_cond, &gc->lock);
+    }
+    pthread_mutex_unlock(&gc->lock);
+    return op.ok;
+}
+
+bool corm_group_save(corm_group_commit_t* gc, model_meta_t* meta, void* instance,
+                     char* error, size_t error_size) {
+    return corm_group_submit(gc, CORM_OP_SAVE, meta, instance, error, error_size);
+}
+
+bool corm_group_delete(corm_group_commit_t* gc, model_meta_t* meta, void* pk_value,
+                       char* error, size_t error_size) {
+    return corm_group_submit(gc, CORM_OP_DELETE, meta, pk_value, error, error_size);
+}
+
+// Polite waiting for the lock-free paths: spin, then yield, then sleep for
+// a growing amount of time capped at one millisecond.
+static void corm_backoff(unsigned* round) {
+    unsigned r = (*round)++;
+    if (r < 64) return;
+    if (r < 128) {
+        sched_yield();
+        return;
+    }
+    unsigned shift = r - 128 < 5 ? r - 128 : 5;
+    struct timespec ts = { 0, (long)(31250L << shift) };
+    nanosleep(&ts, NULL);
+}
+
+// Single writer queue
+//
+// A bounded multi-producer single-consumer ring (one sequence number per
+// slot, producers claim slots with a CAS on enqueue_pos). Producers never
+// take a lock. The consumer thread owns its connection and drains the ring
+// in batches of up to max_batch writes per transaction.
+//
+// Stopping sets CORM_WRITER_CLOSED in enqueue_pos, so no slot can be claimed
+// after it and the consumer knows exactly where the ring ends.
+#define CORM_WRITER_CLOSED ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+typedef struct {
+    size_t seq;
+    corm_op_kind_e kind;
+    model_meta_t* meta;
+    void* target;
+    bool owned;
+    bool ok;
+    corm_write_future_t* future;
+} corm_writer_slot_t;
+
+struct corm_writer_t {
+    corm_db_t* db;
+    corm_db_t* writer;
+    pthread_t thread;
+
+    corm_writer_slot_t* slots;
+    size_t mask;
+    size_t max_batch;
+    corm_writer_slot_t* batch;
+
+    // Producers hammer enqueue_pos, keep it off the consumer's cache line
+    char pad0[64];
+    size_t enqueue_pos;
+    char pad1[64];
+    size_t dequeue_pos;
+};
+
+static void* corm_pk_clone(corm_db_t* db, field_info_t* pk_field, const void* pk_value) {
+    size_t size = corm_field_type_size(pk_field->type);
+    void* copy = corm_alloc_fn(db, size);
+    if (!copy) return NULL;
+    memcpy(copy, pk_value, size);
+
+    if (pk_field->type == FIELD_TYPE_STRING && *(char**)copy) {
+        const char* str = *(char**)copy;
+        size_t len = strlen(str);
+        char* dup = corm_alloc_fn(db, len + 1);
+        if (!dup) {
+            corm_free_fn(db, copy);
+            return NULL;
         }
-        break;
+        memcpy(dup, str, len + 1);
+        *(char**)copy = dup;
     }
-    return true;
+    return copy;
 }
 
-bool corm_save(corm_db_t* db, model_meta_t* meta, void* instance) {
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
-    
-    field_info_t* pk_field = meta->primary_key_field;
-    if (!pk_field) {
-        CORM_SET_ERROR(db, "Primary key field not found in model '%s'", meta->table_name);
-        corm_arena_end_temp(tmp);
-        return false;
+static void corm_pk_free(corm_db_t* db, field_info_t* pk_field, void* copy) {
+    if (pk_field->type == FIELD_TYPE_STRING && *(char**)copy) {
+        corm_free_fn(db, *(char**)copy);
     }
+    corm_free_fn(db, copy);
+}
 
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        field_info_t* field = &meta->fields[i];
-        if (field->validator) {
-            void* field_value = (char*)instance + field->offset;
-            const char* error_msg = NULL;
-            if (!field->validator(instance, field_value, &error_msg)) {
-                CORM_SET_ERROR(db, "Validation failed for field '%s': %s", 
-                         field->name, error_msg ? error_msg : "Unknown error");
-                corm_arena_end_temp(tmp);
-                return false;
-            }
+// Releases what the queue owned and wakes the submitter, if any. The error
+// text has already been copied by then.
+static void corm_writer_complete(corm_writer_t* w, corm_writer_slot_t* op) {
+    if (op->owned) {
+        if (op->kind == CORM_OP_SAVE) {
+            corm_instance_free(w->writer, op->meta, op->target);
+        } else {
+            corm_pk_free(w->writer, op->meta->primary_key_field, op->target);
         }
     }
-    
-    void* pk_value = (char*)instance + pk_field->offset;
-    bool is_update = corm_record_exists(db, meta, pk_field, pk_value);
-    
-    corm_string_t sql;
-    corm_backend_stmt_t stmt;
-    
-    if (is_update) {
-        sql = corm_str_fmt(db->internal_arena, "UPDATE %s SET ", meta->table_name);
-        
-        bool first = true;
-        int param_idx = 1;
-        for (uint64_t i = 0; i < meta->field_count; i++) {
-            field_info_t* field = &meta->fields[i];
 
-            if (field->type == FIELD_TYPE_BELONGS_TO || 
-                field->type == FIELD_TYPE_HAS_MANY) {
-                continue;
-            }
-            
-            if (field->flags & PRIMARY_KEY || field->flags & AUTO_INC) {
-                continue;
-            }
-            
-            if (!first) {
-                sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(", "));
-            }
-            
-            const char* placeholder = db->backend->get_placeholder(param_idx);
-            sql = corm_str_cat(db->internal_arena, sql, 
-                              corm_str_fmt(db->internal_arena, "%s=%s", field->name, placeholder));
-            first = false;
-            param_idx++;
+    if (op->future) {
+        op->future->ok = op->ok;
+        __atomic_store_n(&op->future->state, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void corm_writer_fail_all(corm_writer_t* w, corm_writer_slot_t* batch, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        batch[i].ok = false;
+        if (batch[i].future) {
+            corm_copy_error(w->writer, batch[i].future->error, sizeof(batch[i].future->error));
         }
-        
-        const char* where_placeholder = db->backend->get_placeholder(param_idx);
-        sql = corm_str_cat(db->internal_arena, sql, 
-                          corm_str_fmt(db->internal_arena, " WHERE %s=%s;", pk_field->name, where_placeholder));
-    } else {
-        sql = corm_str_fmt(db->internal_arena, "INSERT INTO %s (", meta->table_name);
-        corm_string_t values = CORM_STR_LIT("VALUES (");
-        
-        bool first = true;
-        int param_idx = 1;
-        for (uint64_t i = 0; i < meta->field_count; i++) {
-            field_info_t* field = &meta->fields[i];
+        corm_writer_complete(w, &batch[i]);
+    }
+}
 
-            if (field->type == FIELD_TYPE_BELONGS_TO || 
-                field->type == FIELD_TYPE_HAS_MANY) {
-                continue;
-            }
+static void corm_writer_run(corm_writer_t* w, corm_writer_slot_t* batch, size_t count) {
+    corm_db_t* writer = w->writer;
 
-            if (field->flags & AUTO_INC) {
-                continue;
-            }
-            
-            if (!first) {
-                sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(", "));
-                values = corm_str_cat(db->internal_arena, values, CORM_STR_LIT(", "));
-            }
-            
-            sql = corm_str_cat(db->internal_arena, sql, corm_str_fmt(db->internal_arena, "%s", field->name));
-            
-            const char* placeholder = db->backend->get_placeholder(param_idx);
-            values = corm_str_cat(db->internal_arena, values, 
-                                 corm_str_fmt(db->internal_arena, "%s", placeholder));
-            first = false;
-            param_idx++;
+    if (!writer->backend->begin_transaction(writer->backend_conn)) {
+        const char* backend_err = writer->backend->get_error(writer->backend_conn);
+        CORM_SET_ERROR(writer, "Failed to begin transaction: %s", backend_err ? backend_err : "unknown error");
+        corm_writer_fail_all(w, batch, count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        batch[i].ok = corm_run_batched_op(writer, batch[i].kind, batch[i].meta, batch[i].target);
+        if (!batch[i].ok && batch[i].future) {
+            corm_copy_error(writer, batch[i].future->error, sizeof(batch[i].future->error));
         }
-        
-        sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(") "));
-        values = corm_str_cat(db->internal_arena, values, CORM_STR_LIT(");"));
-        sql = corm_str_cat(db->internal_arena, sql, values);
     }
-    
-    char* error = NULL;
-    if (!db->backend->prepare(db->backend_conn, &stmt, corm_str_to_c_safe(db->internal_arena, sql), &error)) {
-        CORM_SET_ERROR(db, "Failed to prepare %s: %s", is_update ? "UPDATE" : "INSERT", error ? error : "unknown");
-        if (error) free(error);
-        corm_arena_end_temp(tmp);
-        return false;
+
+    if (!writer->backend->commit(writer->backend_conn)) {
+        const char* backend_err = writer->backend->get_error(writer->backend_conn);
+        CORM_SET_ERROR(writer, "Failed to commit batch: %s", backend_err ? backend_err : "unknown error");
+        writer->backend->rollback(writer->backend_conn);
+        corm_writer_fail_all(w, batch, count);
+        return;
     }
-    
-    int param_idx = 1;
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        field_info_t* field = &meta->fields[i];
 
-        if (field->type == FIELD_TYPE_BELONGS_TO || 
-            field->type == FIELD_TYPE_HAS_MANY) {
-            continue;
+    for (size_t i = 0; i < count; i++) {
+        corm_writer_complete(w, &batch[i]);
+    }
+}
+
+static void* corm_writer_main(void* arg) {
+    corm_writer_t* w = (corm_writer_t*)arg;
+    unsigned idle = 0;
+
+    for (;;) {
+        corm_writer_slot_t* batch = w->batch;
+        size_t count = 0;
+        while (count < w->max_batch) {
+            corm_writer_slot_t* slot = &w->slots[w->dequeue_pos & w->mask];
+            size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            if (seq != w->dequeue_pos + 1) break;
+
+            batch[count++] = *slot;
+            __atomic_store_n(&slot->seq, w->dequeue_pos + w->mask + 1, __ATOMIC_RELEASE);
+            w->dequeue_pos++;
         }
-        
-        if (field->flags & AUTO_INC) {
-            continue;
+
+        // Once closed, a claimed slot that isn't published yet is still
+        // waited for, its producer is about to fill it
+        size_t end = __atomic_load_n(&w->enqueue_pos, __ATOMIC_ACQUIRE);
+        if (count > 0) {
+            corm_writer_run(w, batch, count);
+            idle = 0;
+        } else if ((end & CORM_WRITER_CLOSED) && (end & ~CORM_WRITER_CLOSED) == w->dequeue_pos) {
+            break;
+        } else {
+            corm_backoff(&idle);
         }
-        
-        if (is_update && (field->flags & PRIMARY_KEY)) {
-            continue;
+    }
+    return NULL;
+}
+
+corm_writer_t* corm_writer_start(corm_db_t* db, size_t capacity, size_t max_batch) {
+    if (!db) return NULL;
+    // A batch never holds more than the ring, and the ring's size has to
+    // stay below the closed bit
+    if (capacity < 2 || capacity > CORM_WRITER_CLOSED / sizeof(corm_writer_slot_t) ||
+        max_batch == 0 || max_batch > capacity) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_writer_start");
+        return NULL;
+    }
+
+    corm_writer_t* w = CORM_MALLOC(sizeof(corm_writer_t));
+    if (!w) {
+        CORM_SET_ERROR(db, "Failed to allocate writer");
+        return NULL;
+    }
+    memset(w, 0, sizeof(*w));
+
+    size_t slots = 2;
+    while (slots < capacity) slots <<= 1;
+    w->slots = CORM_MALLOC(sizeof(corm_writer_slot_t) * slots);
+    w->batch = CORM_MALLOC(sizeof(corm_writer_slot_t) * max_batch);
+    if (!w->slots || !w->batch) {
+        CORM_SET_ERROR(db, "Failed to allocate writer queue");
+        CORM_FREE(w->slots);
+        CORM_FREE(w->batch);
+        CORM_FREE(w);
+        return NULL;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        memset(&w->slots[i], 0, sizeof(corm_writer_slot_t));
+        w->slots[i].seq = i;
+    }
+    w->mask = slots - 1;
+    w->max_batch = max_batch;
+    w->db = db;
+
+    w->writer = corm_open_sibling(db);
+    if (!w->writer) {
+        CORM_FREE(w->slots);
+        CORM_FREE(w->batch);
+        CORM_FREE(w);
+        return NULL;
+    }
+
+    if (pthread_create(&w->thread, NULL, corm_writer_main, w) != 0) {
+        CORM_SET_ERROR(db, "Failed to start writer thread");
+        corm_close(w->writer);
+        CORM_FREE(w->slots);
+        CORM_FREE(w->batch);
+        CORM_FREE(w);
+        return NULL;
+    }
+    return w;
+}
+
+void corm_writer_stop(corm_writer_t* w) {
+    if (!w) return;
+
+    // The consumer drains everything claimed before the close, then exits
+    __atomic_fetch_or(&w->enqueue_pos, CORM_WRITER_CLOSED, __ATOMIC_ACQ_REL);
+    pthread_join(w->thread, NULL);
+
+    corm_close(w->writer);
+    CORM_FREE(w->slots);
+    CORM_FREE(w->batch);
+    CORM_FREE(w);
+}
+
+// Fire-and-forget writes have no future to report to, their errors go to
+// the handle the writer was started from
+#define CORM_WRITER_ERROR(w, fmt, ...) \
+    do { \
+        corm_db_t* owner_ = corm_route((w)->db); \
+        if (owner_) CORM_SET_ERROR(owner_, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+// Fails a write that never made it into the ring
+static bool corm_writer_reject(corm_writer_t* w, corm_op_kind_e kind, model_meta_t* meta, void* target,
+                               bool owned, corm_write_future_t* future, const char* message) {
+    if (owned) {
+        corm_writer_slot_t op = { .kind = kind, .meta = meta, .target = target, .owned = true };
+        corm_writer_complete(w, &op);
+        CORM_WRITER_ERROR(w, "%s", message);
+    } else {
+        snprintf(future->error, sizeof(future->error), "%s", message);
+        __atomic_store_n(&future->state, 1, __ATOMIC_RELEASE);
+    }
+    return false;
+}
+
+static bool corm_writer_submit(corm_writer_t* w, corm_op_kind_e kind, model_meta_t* meta, void* target,
+                               corm_write_future_t* future, int flags) {
+    if (__atomic_load_n(&w->enqueue_pos, __ATOMIC_ACQUIRE) & CORM_WRITER_CLOSED) {
+        if (future) {
+            future->ok = false;
+            snprintf(future->error, sizeof(future->error), "Writer is stopped");
+            __atomic_store_n(&future->state, 1, __ATOMIC_RELEASE);
+        } else {
+            CORM_WRITER_ERROR(w, "Writer is stopped");
         }
-        
-        void* field_value = (char*)instance + field->offset;
-        
-        if (!bind_param_by_type(db, stmt, param_idx, field_value, field->type)) {
-            CORM_SET_ERROR(db, "Failed to bind parameter %d for field '%s'", param_idx, field->name);
-            db->backend->finalize(stmt);
-            corm_arena_end_temp(tmp);
-            return false;
+        return false;
+    }
+
+    if (!meta->primary_key_field) {
+        if (future) {
+            future->ok = false;
+            snprintf(future->error, sizeof(future->error), "Model '%s' has no primary key", meta->table_name);
+            __atomic_store_n(&future->state, 1, __ATOMIC_RELEASE);
+        } else {
+            CORM_WRITER_ERROR(w, "Model '%s' has no primary key", meta->table_name);
         }
-        
-        param_idx++;
+        return false;
     }
-    
-    if (is_update) {
-        if (!bind_param_by_type(db, stmt, param_idx, pk_value, pk_field->type)) {
-            db->backend->finalize(stmt);
-            corm_arena_end_temp(tmp);
+
+    // Fire-and-forget writes outlive the caller's buffer, so they're copied
+    bool owned = future == NULL;
+    if (owned) {
+        target = kind == CORM_OP_SAVE
+            ? corm_instance_clone(w->writer, meta, target)
+            : corm_pk_clone(w->writer, meta->primary_key_field, target);
+        if (!target) {
+            CORM_WRITER_ERROR(w, "Failed to copy write for the writer queue");
             return false;
         }
+    } else {
+        future->state = 0;
+        future->ok = false;
+        future->error[0] = 0;
     }
-    
-    int result = db->backend->step(stmt);
-    if (result < 0) {
-        const char* backend_err = db->backend->get_error(db->backend_conn);
-        CORM_SET_ERROR(db, "Failed to execute %s: %s", 
-                       is_update ? "UPDATE" : "INSERT",
-                       backend_err ? backend_err : "unknown error");
-        db->backend->finalize(stmt);
-        corm_arena_end_temp(tmp);
-        return false;
-    }
-    
-    if (!is_update && (pk_field->flags & AUTO_INC)) {
-        int64_t last_id = db->backend->last_insert_id(db->backend_conn);
-        
-        void* pk_ptr = (char*)instance + pk_field->offset;
-        if (pk_field->type == FIELD_TYPE_INT) {
-            *(int*)pk_ptr = (int)last_id;
-        } else if (pk_field->type == FIELD_TYPE_INT64) {
-            *(int64_t*)pk_ptr = last_id;
+
+    unsigned round = 0;
+    size_t pos = __atomic_load_n(&w->enqueue_pos, __ATOMIC_RELAXED);
+    corm_writer_slot_t* slot;
+    for (;;) {
+        if (pos & CORM_WRITER_CLOSED) {
+            return corm_writer_reject(w, kind, meta, target, owned, future, "Writer is stopped");
+        }
+        slot = &w->slots[pos & w->mask];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&w->enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full. Either give up or wait for the consumer to catch up
+            if (flags & CORM_WRITER_NONBLOCK) {
+                return corm_writer_reject(w, kind, meta, target, owned, future, "Writer queue is full");
+            }
+            corm_backoff(&round);
+            pos = __atomic_load_n(&w->enqueue_pos, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&w->enqueue_pos, __ATOMIC_RELAXED);
         }
     }
-    
-    db->backend->finalize(stmt);
-    corm_arena_end_temp(tmp);
+
+    slot->kind = kind;
+    slot->meta = meta;
+    slot->target = target;
+    slot->owned = owned;
+    slot->future = future;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
     return true;
 }
 
-corm_query_t* corm_query(corm_db_t* db, model_meta_t* meta) {
-    if (!db || !meta) return NULL;
-
-    corm_query_t* q = corm_alloc_fn(db, sizeof(corm_query_t));
-    if (!q) return NULL;
-
-    q->db          = db;
-    q->meta        = meta;
-    q->where_clause = NULL;
-    q->params      = NULL;
-    q->param_types = NULL;
-    q->param_count = 0;
-    q->order_by    = NULL;
-    q->limit       = -1;
-    q->offset      = 0;
+bool corm_writer_save(corm_writer_t* w, model_meta_t* meta, void* instance,
+                      corm_write_future_t* future, int flags) {
+    return corm_writer_submit(w, CORM_OP_SAVE, meta, instance, future, flags);
+}
 
-    return q;
+bool corm_writer_delete(corm_writer_t* w, model_meta_t* meta, void* pk_value,
+                        corm_write_future_t* future, int flags) {
+    return corm_writer_submit(w, CORM_OP_DELETE, meta, pk_value, future, flags);
 }
 
-void corm_query_where(corm_query_t* q, const char* clause,
-                      void** params, field_type_e* types, size_t count) {
-    q->where_clause = clause;
-    q->params       = params;
-    q->param_types  = types;
-    q->param_count  = count;
+bool corm_write_future_ready(corm_write_future_t* future) {
+    return __atomic_load_n(&future->state, __ATOMIC_ACQUIRE) != 0;
 }
 
-void corm_query_order_by(corm_query_t* q, const char* order_by) {
-    q->order_by = order_by;
+bool corm_write_future_wait(corm_write_future_t* future) {
+    unsigned round = 0;
+    while (!corm_write_future_ready(future)) {
+        corm_backoff(&round);
+    }
+    return future->ok;
 }
 
-void corm_query_limit(corm_query_t* q, int limit) {
-    q->limit = limit;
+// Connection pool
+//
+// Up to 64 sibling connections, free ones are tracked as bits in a single
+// word and claimed with a CAS. Each thread remembers the slot it used last
+// in each of the last few pools it used and tries that one first, so a
+// thread that keeps coming back usually gets the same connection, with its
+// statement cache already warm.
+#define CORM_POOL_MAX 64
+#define CORM_POOL_TLS_WAYS 4
+
+struct corm_pool_t {
+    corm_db_t* conns[CORM_POOL_MAX];
+    size_t size;
+    uint64_t free_mask;
+};
+
+typedef struct {
+    corm_pool_t* pool;
+    size_t slot;
+} corm_pool_pref_t;
+
+static _Thread_local corm_pool_pref_t corm_tls_pool_prefs[CORM_POOL_TLS_WAYS];
+static _Thread_local unsigned corm_tls_pool_next = 0;
+
+static inline corm_pool_pref_t* corm_pool_pref(corm_pool_t* pool) {
+    for (size_t i = 0; i < CORM_POOL_TLS_WAYS; i++) {
+        if (corm_tls_pool_prefs[i].pool == pool) return &corm_tls_pool_prefs[i];
+    }
+    return NULL;
 }
 
-void corm_query_offset(corm_query_t* q, int offset) {
-    q->offset = offset;
+corm_pool_t* corm_pool_create(corm_db_t* db, size_t size) {
+    if (!db || size == 0 || size > CORM_POOL_MAX) {
+        CORM_SET_ERROR(db, "Pool size must be between 1 and %d", CORM_POOL_MAX);
+        return NULL;
+    }
+    if (corm_private_database(db)) {
+        CORM_SET_ERROR(db, "A connection pool needs a database file, '%s' can't be shared",
+                       db->connection_string);
+        return NULL;
+    }
+
+    corm_pool_t* pool = CORM_MALLOC(sizeof(corm_pool_t));
+    if (!pool) {
+        CORM_SET_ERROR(db, "Failed to allocate connection pool");
+        return NULL;
+    }
+    memset(pool, 0, sizeof(*pool));
+
+    for (size_t i = 0; i < size; i++) {
+        pool->conns[i] = corm_open_sibling(db);
+        if (!pool->conns[i]) {
+            for (size_t j = 0; j < i; j++) corm_close(pool->conns[j]);
+            CORM_FREE(pool);
+            return NULL;
+        }
+    }
+
+    pool->size = size;
+    pool->free_mask = size == CORM_POOL_MAX ? ~0ULL : (1ULL << size) - 1;
+    return pool;
 }
 
-corm_result_t* corm_query_exec(corm_query_t* q) {
-    if (!q) return NULL;
+void corm_pool_destroy(corm_pool_t* pool) {
+    if (!pool) return;
+    for (size_t i = 0; i < pool->size; i++) {
+        corm_close(pool->conns[i]);
+    }
+    corm_pool_pref_t* pref = corm_pool_pref(pool);
+    if (pref) pref->pool = NULL;
+    CORM_FREE(pool);
+}
 
-    corm_db_t*    db   = q->db;
-    model_meta_t* meta = q->meta;
+static inline bool corm_pool_claim(corm_pool_t* pool, size_t slot) {
+    uint64_t bit = 1ULL << slot;
+    uint64_t prev = __atomic_fetch_and(&pool->free_mask, ~bit, __ATOMIC_ACQUIRE);
+    return (prev & bit) != 0;
+}
 
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+corm_db_t* corm_pool_try_checkout(corm_pool_t* pool) {
+    corm_pool_pref_t* pref = corm_pool_pref(pool);
+    if (pref && corm_pool_claim(pool, pref->slot)) {
+        return pool->conns[pref->slot];
+    }
 
-    corm_string_t sql = corm_str_fmt(db->internal_arena, "SELECT * FROM %s", meta->table_name);
-
-    if (q->where_clause) {
-        // translate each ? to the backend's placeholder
-        corm_string_t where = CORM_STR_LIT("");
-        const char* cur = q->where_clause;
-        int param_idx = 1;
-        while (*cur) {
-            const char* next = strchr(cur, '?');
-            if (!next) {
-                where = corm_str_cat(db->internal_arena, where,
-                        (corm_string_t){ (uint8_t*)cur, (uint64_t)strlen(cur) });
-                break;
+    uint64_t free_mask = __atomic_load_n(&pool->free_mask, __ATOMIC_RELAXED);
+    while (free_mask) {
+        size_t slot = (size_t)__builtin_ctzll(free_mask);
+        if (corm_pool_claim(pool, slot)) {
+            // A pool new to this thread takes over the oldest remembered one
+            if (!pref) {
+                pref = &corm_tls_pool_prefs[corm_tls_pool_next++ % CORM_POOL_TLS_WAYS];
+                pref->pool = pool;
             }
-            where = corm_str_cat(db->internal_arena, where,
-                    (corm_string_t){ (uint8_t*)cur, (uint64_t)(next - cur) });
-            const char* ph = db->backend->get_placeholder(param_idx++);
-            where = corm_str_cat(db->internal_arena, where,
-                    (corm_string_t){ (uint8_t*)ph, (uint64_t)strlen(ph) });
-            cur = next + 1;
+            pref->slot = slot;
+            return pool->conns[slot];
         }
-        sql = corm_str_cat(db->internal_arena, sql,
-              corm_str_fmt(db->internal_arena, " WHERE %.*s", (int)where.size, where.str));
+        free_mask = __atomic_load_n(&pool->free_mask, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+corm_db_t* corm_pool_checkout(corm_pool_t* pool) {
+    unsigned round = 0;
+    corm_db_t* conn;
+    while (!(conn = corm_pool_try_checkout(pool))) {
+        corm_backoff(&round);
+    }
+    return conn;
+}
+
+void corm_pool_checkin(corm_pool_t* pool, corm_db_t* conn) {
+    size_t slot = 0;
+    corm_pool_pref_t* pref = corm_pool_pref(pool);
+    if (pref && pool->conns[pref->slot] == conn) {
+        slot = pref->slot;
+    } else {
+        while (slot < pool->size && pool->conns[slot] != conn) slot++;
+        if (slot == pool->size) return;
     }
+    __atomic_fetch_or(&pool->free_mask, 1ULL << slot, __ATOMIC_RELEASE);
+}
+
+// Async execution
+//
+// Jobs go onto a mutex protected list drained by a few worker threads, each
+// with its own sibling connection. Finished jobs move to a completion list
+// and the event fd is bumped; the caller's loop runs the callbacks from
+// corm_async_dispatch on its own thread. Writes are serialized between the
+// workers since the database takes them one at a time anyway.
+typedef struct corm_async_job_t {
+    corm_query_t* query;
+    model_meta_t* meta;
+    void* instance;
+
+    corm_async_fn callback;
+    void* userdata;
+    int flags;
+
+    bool ok;
+    corm_result_t* result;
+    char error[256];
+
+    struct corm_async_job_t* next;
+} corm_async_job_t;
+
+typedef struct {
+    corm_async_t* async;
+    corm_db_t* conn;
+    pthread_t thread;
+} corm_async_worker_t;
 
-    if (q->order_by) {
-        sql = corm_str_cat(db->internal_arena, sql,
-              corm_str_fmt(db->internal_arena, " ORDER BY %s", q->order_by));
+struct corm_async_t {
+    corm_db_t* db;
+    corm_async_worker_t* workers;
+    size_t worker_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    corm_async_job_t* head;
+    corm_async_job_t* tail;
+    bool running;
+
+    pthread_mutex_t write_lock;
+
+    pthread_mutex_t done_lock;
+    corm_async_job_t* done_head;
+    corm_async_job_t* done_tail;
+
+    // eventfd on Linux (both ends the same fd), a pipe elsewhere
+    int read_fd;
+    int write_fd;
+};
+
+static bool corm_async_open_fd(corm_async_t* async) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) return false;
+    async->read_fd = fd;
+    async->write_fd = fd;
+#else
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
     }
+    async->read_fd = fds[0];
+    async->write_fd = fds[1];
+#endif
+    return true;
+}
 
-    if (q->limit != -1 || q->offset > 0) {
-        const char* limit_str = db->backend->get_limit_syntax(q->limit, q->offset);
-        sql = corm_str_cat(db->internal_arena, sql,
-              corm_str_fmt(db->internal_arena, " %s", limit_str));
-    }
+static void corm_async_close_fd(corm_async_t* async) {
+    close(async->read_fd);
+    if (async->write_fd != async->read_fd) close(async->write_fd);
+}
 
-    sql = corm_str_cat(db->internal_arena, sql, CORM_STR_LIT(";"));
+static void corm_async_signal(corm_async_t* async) {
+    uint64_t one = 1;
+    ssize_t n;
+    // A full pipe already means the reader has something to wake up for
+    do {
+        n = write(async->write_fd, &one, async->read_fd == async->write_fd ? sizeof(one) : 1);
+    } while (n < 0 && errno == EINTR);
+}
 
-    corm_backend_stmt_t stmt;
-    char* error = NULL;
-    if (!db->backend->prepare(db->backend_conn, &stmt, corm_str_to_c_safe(db->internal_arena, sql), &error)) {
-        CORM_SET_ERROR(db, "Failed to prepare query: %s", error ? error : "unknown");
-        if (error) free(error);
-        corm_free_fn(db, q);
-        corm_arena_end_temp(tmp);
-        return NULL;
+static void corm_async_drain_fd(corm_async_t* async) {
+    uint8_t buf[64];
+    while (read(async->read_fd, buf, sizeof(buf)) > 0) {
+        if (async->read_fd == async->write_fd) break;
     }
+}
 
-    for (size_t i = 0; i < q->param_count; i++) {
-        if (!bind_param_by_type(db, stmt, (int)(i + 1), q->params[i], q->param_types[i])) {
-            CORM_SET_ERROR(db, "Failed to bind parameter %zu", i);
-            db->backend->finalize(stmt);
-            corm_free_fn(db, q);
-            corm_arena_end_temp(tmp);
-            return NULL;
-        }
+static void corm_async_run(corm_async_t* async, corm_db_t* conn, corm_async_job_t* job) {
+    if (job->query) {
+        // A query without rows also returns NULL, only a fresh error fails it
+        job->query->db = conn;
+        conn->last_error[0] = 0;
+        conn->last_error_code = CORM_ERROR_NONE;
+        job->result = corm_query_exec(job->query);
+        job->ok = job->result != NULL || conn->last_error_code == CORM_ERROR_NONE;
+    } else {
+        pthread_mutex_lock(&async->write_lock);
+        job->ok = corm_save(conn, job->meta, job->instance);
+        pthread_mutex_unlock(&async->write_lock);
     }
-
-    int col_count = db->backend->column_count(stmt);
-    int* col_map = corm_arena_alloc(db->internal_arena, sizeof(int) * meta->field_count);
-    if (!col_map) {
-        db->backend->finalize(stmt);
-        corm_free_fn(db, q);
-        corm_arena_end_temp(tmp);
-        return NULL;
+    if (!job->ok) {
+        corm_copy_error(conn, job->error, sizeof(job->error));
     }
 
-    for (uint64_t i = 0; i < meta->field_count; i++) {
-        col_map[i] = -1;
-        if (meta->fields[i].type == FIELD_TYPE_BELONGS_TO ||
-            meta->fields[i].type == FIELD_TYPE_HAS_MANY) continue;
-
-        for (int j = 0; j < col_count; j++) {
-            if (strcmp(db->backend->column_name(stmt, j), meta->fields[i].name) == 0) {
-                col_map[i] = j;
-                break;
-            }
+    if (job->flags & CORM_ASYNC_INLINE) {
+        if (job->callback) {
+            job->callback(async->db, job->ok, job->result, job->ok ? NULL : job->error, job->userdata);
+        } else if (job->result) {
+            corm_free_result(async->db, job->result);
         }
+        CORM_FREE(job);
+        return;
     }
 
-    corm_result_t* res = corm_result_create(db, meta);
-    if (!res) {
-        db->backend->finalize(stmt);
-        corm_free_fn(db, q);
-        corm_arena_end_temp(tmp);
-        return NULL;
-    }
-
-    size_t capacity = 16;
-    void* instances = corm_alloc_fn(db, meta->struct_size * capacity);
-    if (!instances) {
-        CORM_SET_ERROR(db, "Failed to allocate instances array");
-        corm_free_fn(db, res->allocations);
-        corm_free_fn(db, res);
-        db->backend->finalize(stmt);
-        corm_free_fn(db, q);
-        corm_arena_end_temp(tmp);
-        return NULL;
+    pthread_mutex_lock(&async->done_lock);
+    bool was_empty = async->done_head == NULL;
+    if (async->done_tail) {
+        async->done_tail->next = job;
+    } else {
+        async->done_head = job;
     }
+    async->done_tail = job;
+    pthread_mutex_unlock(&async->done_lock);
 
-    size_t count = 0;
-    while (db->backend->step(stmt) == 1) {
-        if (count >= capacity) {
-            size_t new_cap = capacity * 2;
-            void* grown = corm_alloc_fn(db, meta->struct_size * new_cap);
-            if (!grown) {
-                CORM_SET_ERROR(db, "Failed to grow instances array");
-                corm_free_fn(db, instances);
-                corm_free_fn(db, res->allocations);
-                corm_free_fn(db, res);
-                db->backend->finalize(stmt);
-                corm_free_fn(db, q);
-                corm_arena_end_temp(tmp);
-                return NULL;
-            }
-            memcpy(grown, instances, meta->struct_size * count);
-            corm_free_fn(db, instances);
-            instances = grown;
-            capacity  = new_cap;
-        }
+    if (was_empty) corm_async_signal(async);
+}
 
-        void* inst = (char*)instances + (count * meta->struct_size);
-        memset(inst, 0, meta->struct_size);
+static void* corm_async_main(void* arg) {
+    corm_async_worker_t* worker = (corm_async_worker_t*)arg;
+    corm_async_t* async = worker->async;
 
-        for (uint64_t i = 0; i < meta->field_count; i++) {
-            if (col_map[i] == -1) continue;
-            void* field_ptr = (char*)inst + meta->fields[i].offset;
-            extract_field_from_column(db, res, stmt, col_map[i], field_ptr, meta->fields[i].type);
+    pthread_mutex_lock(&async->lock);
+    for (;;) {
+        while (!async->head && async->running) {
+            pthread_cond_wait(&async->cond, &async->lock);
         }
+        if (!async->head) break;
 
-        count++;
+        corm_async_job_t* job = async->head;
+        async->head = job->next;
+        if (!async->head) async->tail = NULL;
+        job->next = NULL;
+
+        pthread_mutex_unlock(&async->lock);
+        corm_async_run(async, worker->conn, job);
+        pthread_mutex_lock(&async->lock);
     }
+    pthread_mutex_unlock(&async->lock);
+    return NULL;
+}
 
-    db->backend->finalize(stmt);
-    corm_free_fn(db, q);
-    corm_arena_end_temp(tmp);
+static void corm_async_stop_workers(corm_async_t* async, size_t count) {
+    pthread_mutex_lock(&async->lock);
+    async->running = false;
+    pthread_cond_broadcast(&async->cond);
+    pthread_mutex_unlock(&async->lock);
 
-    if (count == 0) {
-        corm_free_fn(db, instances);
-        corm_free_fn(db, res->allocations);
-        corm_free_fn(db, res);
-        return NULL;
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(async->workers[i].thread, NULL);
     }
+}
 
-    res->data  = instances;
-    res->count = (int)count;
-
-    return res;
+static void corm_async_free(corm_async_t* async) {
+    for (size_t i = 0; i < async->worker_count; i++) {
+        corm_close(async->workers[i].conn);
+    }
+    corm_async_close_fd(async);
+    pthread_mutex_destroy(&async->done_lock);
+    pthread_mutex_destroy(&async->write_lock);
+    pthread_cond_destroy(&async->cond);
+    pthread_mutex_destroy(&async->lock);
+    CORM_FREE(async->workers);
+    CORM_FREE(async);
 }
 
-bool corm_delete(corm_db_t* db, model_meta_t* meta, void* pk_value) {
-    if (!db || !meta || !pk_value) {
-        CORM_SET_ERROR(db, "Invalid arguments to corm_delete");
+bool corm_async_enable(corm_db_t* db, size_t workers) {
+    if (!db || workers == 0) {
+        CORM_SET_ERROR(db, "Invalid arguments to corm_async_enable");
         return false;
     }
-    
-    if (!meta->primary_key_field) {
-        CORM_SET_ERROR(db, "Model '%s' has no primary key", meta->table_name);
+    if (db->async) {
+        CORM_SET_ERROR(db, "Async execution is already enabled");
         return false;
     }
-    
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
-    
-    const char* placeholder = db->backend->get_placeholder(1);
-    corm_string_t sql = corm_str_fmt(db->internal_arena, "DELETE FROM %s WHERE %s = %s;",
-                           meta->table_name, meta->primary_key_field->name, placeholder);
-    
-    corm_backend_stmt_t stmt;
-    char* error = NULL;
-    if (!db->backend->prepare(db->backend_conn, &stmt, corm_str_to_c_safe(db->internal_arena, sql), &error)) {
-        CORM_SET_ERROR(db, "Failed to prepare DELETE: %s", error ? error : "unknown");
-        if (error) free(error);
-        corm_arena_end_temp(tmp);
+    if (corm_private_database(db)) {
+        CORM_SET_ERROR(db, "Async workers need a database file, '%s' can't be shared",
+                       db->connection_string);
         return false;
     }
-    
-    if (!bind_param_by_type(db, stmt, 1, pk_value, meta->primary_key_field->type)) {
-        CORM_SET_ERROR(db, "Failed to bind primary key");
-        db->backend->finalize(stmt);
-        corm_arena_end_temp(tmp);
+
+    corm_async_t* async = CORM_MALLOC(sizeof(corm_async_t));
+    corm_async_worker_t* slots = CORM_MALLOC(sizeof(corm_async_worker_t) * workers);
+    if (!async || !slots) {
+        CORM_SET_ERROR(db, "Failed to allocate async workers");
+        if (async) CORM_FREE(async);
+        if (slots) CORM_FREE(slots);
         return false;
     }
-    
-    int result = db->backend->step(stmt);
-    db->backend->finalize(stmt);
-    corm_arena_end_temp(tmp);
-    
-    if (result < 0) {
-        const char* backend_err = db->backend->get_error(db->backend_conn);
-        CORM_SET_ERROR(db, "Failed to execute DELETE: %s", backend_err ? backend_err : "unknown error");
+    memset(async, 0, sizeof(*async));
+    memset(slots, 0, sizeof(corm_async_worker_t) * workers);
+    async->db = db;
+    async->workers = slots;
+
+    if (!corm_async_open_fd(async)) {
+        CORM_SET_ERROR(db, "Failed to create completion fd: %s", strerror(errno));
+        CORM_FREE(slots);
+        CORM_FREE(async);
         return false;
     }
-    
-    return true;
-}
 
-static corm_result_t* corm_load_belongs_to(corm_db_t* db, void* instance, model_meta_t* meta,
-								 field_info_t* field) {
-    field_info_t* fk_field = NULL;
-    for (size_t i = 0; i < meta->field_count; i++) {
-        if (strcmp(meta->fields[i].name, field->fk_column_name) == 0) {
-            fk_field = &meta->fields[i];
-            break;
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->cond, NULL);
+    pthread_mutex_init(&async->write_lock, NULL);
+    pthread_mutex_init(&async->done_lock, NULL);
+
+    for (size_t i = 0; i < workers; i++) {
+        corm_db_t* conn = corm_open_sibling(db);
+        if (!conn) {
+            corm_async_free(async);
+            return false;
         }
+        // Lets queries on the worker use db's read-only connections too
+        conn->parent = db;
+        slots[i].async = async;
+        slots[i].conn = conn;
+        async->worker_count++;
     }
-    
-    if (!fk_field) {
-        CORM_SET_ERROR(db, "Foreign key field '%s' not found in model '%s'", 
-                 field->fk_column_name, meta->table_name);
-        return NULL;
-    }
-    
-    if (!field->related_model) {
-        CORM_SET_ERROR(db, "Related model not resolved for field '%s'", field->name);
-        return NULL;
-    }
-    
-    void* fk_value_ptr = (char*)instance + fk_field->offset;
-    
-    bool is_null = false;
-    switch (fk_field->type) {
-        case FIELD_TYPE_INT:
-            is_null = (*(int*)fk_value_ptr == 0);
-            break;
-        case FIELD_TYPE_BOOL:
-            is_null = (*(bool*)fk_value_ptr == 0);
-            break;
-        case FIELD_TYPE_INT64:
-            is_null = (*(int64_t*)fk_value_ptr == 0);
-            break;
-        case FIELD_TYPE_STRING:
-            is_null = (*(char**)fk_value_ptr == NULL);
-            break;
-        default:
-            break;
-    }
-    
-    if (is_null) {
-        void* relation_ptr = (char*)instance + field->offset;
-        *(void**)relation_ptr = NULL;
-        return NULL;
-    }
-    
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
-
-    const char* placeholder = db->backend->get_placeholder(1);
-    corm_string_t where = corm_str_fmt(db->internal_arena, "%s = %s",
-                                       field->related_model->primary_key_field->name,
-                                       placeholder);
 
-    void* params[]          = { fk_value_ptr };
-    field_type_e types[]    = { fk_field->type };
-
-    corm_query_t* q = corm_query(db, field->related_model);
-    if (!q) {
-        corm_arena_end_temp(tmp);
-        return NULL;
+    async->running = true;
+    for (size_t i = 0; i < workers; i++) {
+        if (pthread_create(&slots[i].thread, NULL, corm_async_main, &slots[i]) != 0) {
+            CORM_SET_ERROR(db, "Failed to start async worker thread");
+            corm_async_stop_workers(async, i);
+            corm_async_free(async);
+            return false;
+        }
     }
 
-    corm_query_where(q, (const char*)where.str, params, types, 1);
-    corm_result_t* related_result = corm_query_exec(q);
-
-    corm_arena_end_temp(tmp);
+    db->async = async;
+    return true;
+}
 
-    if (!related_result) {
-        return NULL;
-    }
+void corm_async_disable(corm_db_t* db) {
+    if (!db || !db->async) return;
+    corm_async_t* async = db->async;
 
-    void* relation_ptr = (char*)instance + field->offset;
-    *(void**)relation_ptr = related_result->data;
+    // Queued jobs still run, and their callbacks fire here
+    corm_async_stop_workers(async, async->worker_count);
+    corm_async_dispatch(db);
 
-    return related_result;
+    db->async = NULL;
+    corm_async_free(async);
 }
 
-static corm_result_t* corm_load_has_many(corm_db_t* db, void* instance, model_meta_t* meta,
-										field_info_t* field) {
-    
-    if (!field->related_model) {
-        CORM_SET_ERROR(db, "Related model not resolved for field '%s'", field->name);
-        return NULL;
-    }
-    
-    void* pk_value = (char*)instance + meta->primary_key_field->offset;
+int corm_async_fd(corm_db_t* db) {
+    if (!db || !db->async) return -1;
+    return db->async->read_fd;
+}
 
-    corm_temp_t tmp = corm_arena_start_temp(db->internal_arena);
+size_t corm_async_dispatch(corm_db_t* db) {
+    if (!db || !db->async) return 0;
+    corm_async_t* async = db->async;
 
-    const char* placeholder = db->backend->get_placeholder(1);
-    corm_string_t where = corm_str_fmt(db->internal_arena, "%s = %s",
-                                       field->fk_column_name, placeholder);
+    corm_async_drain_fd(async);
 
-    void* params[]          = { pk_value };
-    field_type_e types[]    = { meta->primary_key_field->type };
+    pthread_mutex_lock(&async->done_lock);
+    corm_async_job_t* job = async->done_head;
+    async->done_head = NULL;
+    async->done_tail = NULL;
+    pthread_mutex_unlock(&async->done_lock);
 
-    corm_query_t* q = corm_query(db, field->related_model);
-    if (!q) {
-        corm_arena_end_temp(tmp);
-        *(void**)((char*)instance + field->offset)          = NULL;
-        *(int*)((char*)instance + field->count_offset)      = 0;
-        return NULL;
+    size_t count = 0;
+    while (job) {
+        corm_async_job_t* next = job->next;
+        if (job->callback) {
+            job->callback(db, job->ok, job->result, job->ok ? NULL : job->error, job->userdata);
+        } else if (job->result) {
+            corm_free_result(db, job->result);
+        }
+        CORM_FREE(job);
+        job = next;
+        count++;
     }
+    return count;
+}
 
-    corm_query_where(q, (const char*)where.str, params, types, 1);
-    corm_result_t* result = corm_query_exec(q);
-
-    corm_arena_end_temp(tmp);
-    
-    void* relation_ptr = (char*)instance + field->offset;
-	void* count_ptr = (char*)instance + field->count_offset;
-
-	if (result) {
-        *(void**)relation_ptr = result->data;
-        *(int*)count_ptr = result->count;
+// Errors go to `conn`, the routed connection the caller reads them from
+static bool corm_async_submit(corm_async_t* async, corm_db_t* conn, corm_async_job_t* job) {
+    pthread_mutex_lock(&async->lock);
+    if (!async->running) {
+        pthread_mutex_unlock(&async->lock);
+        CORM_SET_ERROR(conn, "Async execution is stopped");
+        return false;
+    }
+    if (async->tail) {
+        async->tail->next = job;
     } else {
-        *(void**)relation_ptr = NULL;
-        *(int*)count_ptr = 0;
+        async->head = job;
     }
-    
-    return result;
+    async->tail = job;
+    pthread_cond_signal(&async->cond);
+    pthread_mutex_unlock(&async->lock);
+    return true;
 }
 
-corm_result_t* corm_load_relation(corm_db_t* db, model_meta_t* meta, void* instance, const char* field_name) {
-    field_info_t* field = NULL;
-    for (size_t i = 0; i < meta->field_count; i++) {
-        if (strcmp(meta->fields[i].name, field_name) == 0) {
-            field = &meta->fields[i];
-            break;
-        }
-    }
-    
-    if (!field) {
-        CORM_SET_ERROR(db, "Field '%s' doesn't exist in %s", field_name, meta->table_name);
+static corm_async_job_t* corm_async_job_new(corm_db_t* db, corm_db_t* conn,
+                                            corm_async_fn callback, void* userdata, int flags) {
+    if (!db->async) {
+        CORM_SET_ERROR(conn, "Async execution isn't enabled, call corm_async_enable first");
         return NULL;
     }
-    
-    if (field->type == FIELD_TYPE_BELONGS_TO) {
-        return corm_load_belongs_to(db, instance, meta, field);
-    } else if (field->type == FIELD_TYPE_HAS_MANY) {
-        return corm_load_has_many(db, instance, meta, field);
+
+    corm_async_job_t* job = CORM_MALLOC(sizeof(corm_async_job_t));
+    if (!job) {
+        CORM_SET_ERROR(conn, "Failed to allocate async job");
+        return NULL;
     }
-    
-    return NULL;
+    memset(job, 0, sizeof(*job));
+    job->callback = callback;
+    job->userdata = userdata;
+    job->flags = flags;
+    return job;
 }
 
-void corm_free_result(corm_db_t* db, corm_result_t* result) {
-    if (!result) return;
-    
-	if (result->allocations) {
-        for (size_t i = 0; i < result->allocation_count; i++) {
-            if (result->allocations[i]) {
-                corm_free_fn(db, result->allocations[i]);
-            }
-        }
-        corm_free_fn(db, result->allocations);
+bool corm_query_exec_async(corm_query_t* q, corm_async_fn callback, void* userdata) {
+    return corm_query_exec_async_ex(q, callback, userdata, 0);
+}
+
+bool corm_query_exec_async_ex(corm_query_t* q, corm_async_fn callback, void* userdata, int flags) {
+    if (!q) return false;
+
+    corm_db_t* db = q->db;
+    corm_db_t* conn = corm_route(db);
+    corm_async_job_t* job = conn ? corm_async_job_new(db, conn, callback, userdata, flags) : NULL;
+    if (!job) {
+        corm_query_release(q);
+        return false;
     }
-    
-	if (result->data) {
-        corm_free_fn(db, result->data);
+
+    // Snapshots belong to the connection that took them, which here would
+    // be a worker's
+    q->track_changes = false;
+    job->query = q;
+
+    if ((q->read_your_writes && !corm_write_barrier(conn)) ||
+        !corm_async_submit(db->async, conn, job)) {
+        CORM_FREE(job);
+        corm_query_release(q);
+        return false;
     }
+    return true;
+}
 
-    corm_free_fn(db, result);
+bool corm_save_async(corm_db_t* db, model_meta_t* meta, void* instance,
+                     corm_async_fn callback, void* userdata) {
+    return corm_save_async_ex(db, meta, instance, callback, userdata, 0);
+}
+
+bool corm_save_async_ex(corm_db_t* db, model_meta_t* meta, void* instance,
+                        corm_async_fn callback, void* userdata, int flags) {
+    if (!db || !meta || !instance) return false;
+
+    corm_db_t* conn = corm_route(db);
+    corm_async_job_t* job = conn ? corm_async_job_new(db, conn, callback, userdata, flags) : NULL;
+    if (!job) return false;
+
+    job->meta = meta;
+    job->instance = instance;
+
+    // Anything still buffered for this row has to land first
+    if (!corm_write_barrier(conn) || !corm_async_submit(db->async, conn, job)) {
+        CORM_FREE(job);
+        return false;
+    }
+    return true;
 }
@@ -0,0 +1,10 @@
+// Unity build of the core with the SQLite backend compiled in. Binding,
+// stepping and column reads in corm.c call the sqlite_* functions directly
+// instead of through corm_backend_ops_t, so they can be inlined.
+// Only the SQLite backend can be used with this build.
+//
+// make CORM_STATIC_BACKEND=sqlite
+#define CORM_STATIC_BACKEND_SQLITE
+
+#include "../backends/sqlite/corm_backend_sqlite.c"
+#include "corm.c"
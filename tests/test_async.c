@@ -0,0 +1,161 @@
+// Async queries and saves from several threads: every job calls back once,
+// a query that matches nothing succeeds with a NULL result, and a failed
+// query's error doesn't leak into the next job on the same worker.
+//
+// make test
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int age;
+} Person;
+
+DEFINE_MODEL(Person, Person,
+    F_INT(Person, id, PRIMARY_KEY),
+    F_STRING(Person, name),
+    F_INT(Person, age)
+);
+
+#define DB_PATH "test_async.db"
+#define THREADS 4
+#define PER_THREAD 100
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    int done;
+    int ok;
+    int rows;
+    char error[256];
+} outcome_t;
+
+static void record(corm_db_t* db, bool ok, corm_result_t* result, const char* error, void* userdata) {
+    outcome_t* out = userdata;
+    out->done++;
+    out->ok += ok;
+    out->rows += result ? result->count : 0;
+    snprintf(out->error, sizeof(out->error), "%s", error ? error : "");
+    corm_free_result(db, result);
+}
+
+static void wait_for(corm_db_t* db, const int* done, int expected) {
+    struct pollfd pfd = { .fd = corm_async_fd(db), .events = POLLIN };
+    while (*done < expected) {
+        if (poll(&pfd, 1, 5000) <= 0) {
+            CHECK(false, "timed out waiting for callbacks, %d of %d", *done, expected);
+            return;
+        }
+        corm_async_dispatch(db);
+    }
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+typedef struct {
+    corm_db_t* db;
+    outcome_t* saves;
+    int first_id;
+    Person people[PER_THREAD];
+    bool submitted;
+} producer_t;
+
+// Submitting is safe from any thread, callbacks still run on the dispatcher
+static void* produce(void* arg) {
+    producer_t* p = arg;
+    p->submitted = true;
+    for (int i = 0; i < PER_THREAD; i++) {
+        p->people[i] = (Person){ .id = p->first_id + i, .name = "async", .age = i };
+        if (!corm_save_async(p->db, &Person_model, &p->people[i], record, p->saves)) {
+            p->submitted = false;
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    remove_db();
+    corm_db_t* db = corm_init(DB_PATH);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Person_model);
+    if (!corm_sync(db, CORM_SYNC_DROP) || !corm_async_enable(db, 1)) {
+        printf("FAIL: setup: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    // One worker, so the empty query runs right after the failing one
+    outcome_t failed = { 0 };
+    corm_query_t* bad = corm_query(db, &Person_model);
+    corm_query_where(bad, "no_such_column = 1", NULL, NULL, 0);
+    CHECK(corm_query_exec_async(bad, record, &failed), "submit: %s", corm_get_last_error(db));
+    wait_for(db, &failed.done, 1);
+    CHECK(failed.ok == 0 && failed.error[0], "bad query should fail with an error");
+
+    outcome_t empty = { 0 };
+    CHECK(corm_query_exec_async(corm_query(db, &Person_model), record, &empty), "submit: %s", corm_get_last_error(db));
+    wait_for(db, &empty.done, 1);
+    CHECK(empty.ok == 1, "query without rows failed: %s", empty.error);
+    CHECK(empty.rows == 0 && empty.error[0] == 0, "query without rows got %d rows, error '%s'", empty.rows, empty.error);
+
+    corm_async_disable(db);
+    CHECK(corm_async_enable(db, 4), "enable: %s", corm_get_last_error(db));
+
+    // Saves submitted from several threads
+    outcome_t saves = { 0 };
+    producer_t producers[THREADS];
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        producers[t].db = db;
+        producers[t].saves = &saves;
+        producers[t].first_id = 1 + t * PER_THREAD;
+        pthread_create(&threads[t], NULL, produce, &producers[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(producers[t].submitted, "thread %d couldn't submit its saves", t);
+    }
+    wait_for(db, &saves.done, THREADS * PER_THREAD);
+    CHECK(saves.ok == THREADS * PER_THREAD, "%d of %d saves failed: %s",
+          THREADS * PER_THREAD - saves.ok, THREADS * PER_THREAD, saves.error);
+
+    outcome_t all = { 0 };
+    CHECK(corm_query_exec_async(corm_query(db, &Person_model), record, &all), "submit: %s", corm_get_last_error(db));
+    wait_for(db, &all.done, 1);
+    CHECK(all.ok == 1 && all.rows == THREADS * PER_THREAD, "expected %d rows, got %d (%s)",
+          THREADS * PER_THREAD, all.rows, all.error);
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("async: ok\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+// co_await corm::find on a missing key and corm::query without matches give
+// an empty corm::result instead of throwing.
+//
+// make test
+
+#include <atomic>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <unistd.h>
+
+#include "corm_coro.hpp"
+
+typedef struct {
+    int id;
+    char* name;
+} Person;
+
+DEFINE_MODEL(Person, Person,
+    F_INT(Person, id, PRIMARY_KEY),
+    F_STRING(Person, name)
+);
+
+#define DB_PATH "test_coro.db"
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+// Starts right away and runs to the end, nothing awaits it
+struct task {
+    struct promise_type {
+        task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+static task run(corm_db_t* db, std::atomic<bool>* done) {
+    try {
+        int missing = 42;
+        corm::result none = co_await corm::find(db, &Person_model, &missing);
+        CHECK(none.empty(), "missing key returned %d rows", none.size());
+
+        int present = 1;
+        corm::result one = co_await corm::find(db, &Person_model, &present);
+        CHECK(one.size() == 1 && one.at<Person>(0).id == 1, "existing key returned %d rows", one.size());
+
+        corm_query_t* q = corm_query(db, &Person_model);
+        corm_query_where(q, "name = 'nobody'", nullptr, nullptr, 0);
+        corm::result nothing = co_await corm::query(q);
+        CHECK(nothing.empty(), "query without matches returned %d rows", nothing.size());
+    } catch (const corm::error& e) {
+        CHECK(false, "threw: %s", e.what());
+    }
+    done->store(true, std::memory_order_release);
+}
+
+static void remove_db() {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+int main() {
+    remove_db();
+    corm_db_t* db = corm_init(DB_PATH);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Person_model);
+    Person someone = { 1, (char*)"someone" };
+    if (!corm_sync(db, CORM_SYNC_DROP) || !corm_save(db, &Person_model, &someone) ||
+        !corm_async_enable(db, 2)) {
+        printf("FAIL: setup: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    std::atomic<bool> done{false};
+    run(db, &done);
+    for (int waited = 0; !done.load(std::memory_order_acquire) && waited < 5000; waited++) {
+        usleep(1000);
+    }
+    CHECK(done.load(std::memory_order_acquire), "coroutine didn't finish");
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("coro: ok\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Group commit: saves and deletes from several threads share commits, each
+// call reports its own outcome, and every write has landed once it returns.
+//
+// make test
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int value;
+} Event;
+
+DEFINE_MODEL(Event, Event,
+    F_INT(Event, id, PRIMARY_KEY),
+    F_STRING(Event, name, NOT_NULL),
+    F_INT(Event, value)
+);
+
+#define DB_PATH "test_group_commit.db"
+#define THREADS 4
+#define PER_THREAD 200
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    corm_group_commit_t* gc;
+    int first_id;
+    int failed;
+    char error[256];
+} committer_t;
+
+// Saves PER_THREAD rows and deletes every fourth one again
+static void* commit_writes(void* arg) {
+    committer_t* c = arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        Event e = { .id = c->first_id + i, .name = "event", .value = i };
+        if (!corm_group_save(c->gc, &Event_model, &e, c->error, sizeof(c->error))) c->failed++;
+        if (i % 4 == 3) {
+            int id = e.id;
+            if (!corm_group_delete(c->gc, &Event_model, &id, c->error, sizeof(c->error))) c->failed++;
+        }
+    }
+    return NULL;
+}
+
+static int count_events(corm_db_t* db) {
+    corm_query_t q;
+    corm_query_init(&q, db, &Event_model);
+    corm_result_t* res = corm_query_exec(&q);
+    int count = res ? res->count : 0;
+    corm_free_result(db, res);
+    return count;
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+int main(void) {
+    remove_db();
+    corm_db_t* db = corm_init(DB_PATH);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Event_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    corm_group_commit_t* gc = corm_group_commit_start(db, 500, 32);
+    CHECK(gc, "start: %s", corm_get_last_error(db));
+    if (!gc) {
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    committer_t committers[THREADS];
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        committers[t] = (committer_t){ .gc = gc, .first_id = 1 + t * PER_THREAD };
+        pthread_create(&threads[t], NULL, commit_writes, &committers[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(committers[t].failed == 0, "thread %d had %d writes fail: %s", t,
+              committers[t].failed, committers[t].error);
+    }
+
+    // Every call has returned, so its write is visible without stopping first
+    int expected = THREADS * (PER_THREAD - PER_THREAD / 4);
+    CHECK(count_events(db) == expected, "expected %d rows, got %d", expected, count_events(db));
+
+    // A write that can't be applied fails on its own call only
+    char error[256] = "";
+    Event bad = { .id = 1, .name = NULL, .value = 0 };
+    Event good = { .id = THREADS * PER_THREAD + 1, .name = "late", .value = 0 };
+    CHECK(!corm_group_save(gc, &Event_model, &bad, error, sizeof(error)), "a NULL name should be rejected");
+    CHECK(error[0], "a failed save should report why");
+    CHECK(corm_group_save(gc, &Event_model, &good, error, sizeof(error)), "save after a failed one: %s", error);
+
+    corm_group_commit_stop(gc);
+    CHECK(count_events(db) == expected + 1, "expected %d rows, got %d", expected + 1, count_events(db));
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("group commit: ok\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+// The connection pool: threads checking connections in and out while they
+// save and query end up with every row written, and a thread that switches
+// between two pools gets back the connection it used last in each.
+//
+// make test
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    int worker;
+} Item;
+
+DEFINE_MODEL(Item, Item,
+    F_INT(Item, id, PRIMARY_KEY),
+    F_INT(Item, worker)
+);
+
+#define DB_PATH "test_pool.db"
+#define POOL_SIZE 4
+#define THREADS 8
+#define PER_THREAD 200
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    corm_pool_t* pool;
+    int worker;
+    int failed;
+    int seen;  // rows of its own the worker read back
+} worker_t;
+
+static void* work(void* arg) {
+    worker_t* w = arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        corm_db_t* conn = corm_pool_checkout(w->pool);
+
+        Item item = { .id = w->worker * PER_THREAD + i + 1, .worker = w->worker };
+        if (!corm_save(conn, &Item_model, &item)) w->failed++;
+
+        void* params[] = { &w->worker };
+        field_type_e types[] = { FIELD_TYPE_INT };
+        corm_query_t q;
+        corm_query_init(&q, conn, &Item_model);
+        corm_query_where(&q, "worker = ?", params, types, 1);
+        corm_result_t* res = corm_query_exec(&q);
+        w->seen = res ? res->count : 0;
+        corm_free_result(conn, res);
+
+        corm_pool_checkin(w->pool, conn);
+    }
+    return NULL;
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+// Leaves the thread's remembered connection in `pool` at slot 2
+static corm_db_t* settle_on_third(corm_pool_t* pool) {
+    corm_db_t* held[2] = { corm_pool_checkout(pool), corm_pool_checkout(pool) };
+    corm_db_t* third = corm_pool_checkout(pool);
+    corm_pool_checkin(pool, held[0]);
+    corm_pool_checkin(pool, held[1]);
+    corm_pool_checkin(pool, third);
+    return third;
+}
+
+int main(void) {
+    remove_db();
+    // WAL with a busy timeout, pooled connections write concurrently
+    corm_config_t config;
+    corm_config_preset("throughput", &config);
+    corm_db_t* db = corm_init_with_config(DB_PATH, &config);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Item_model);
+    corm_pool_t* pool = NULL;
+    if (!corm_sync(db, CORM_SYNC_DROP) || !(pool = corm_pool_create(db, POOL_SIZE))) {
+        printf("FAIL: setup: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    worker_t workers[THREADS];
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        workers[t] = (worker_t){ .pool = pool, .worker = t };
+        pthread_create(&threads[t], NULL, work, &workers[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(workers[t].failed == 0, "worker %d: %d saves failed", t, workers[t].failed);
+        CHECK(workers[t].seen == PER_THREAD, "worker %d read back %d of its %d rows", t, workers[t].seen, PER_THREAD);
+    }
+
+    // Switching between two pools keeps the connection remembered in each
+    corm_pool_t* other = corm_pool_create(db, POOL_SIZE);
+    CHECK(other, "second pool: %s", corm_get_last_error(db));
+    if (other) {
+        corm_db_t* mine = settle_on_third(pool);
+        corm_db_t* other_mine = settle_on_third(other);
+        for (int i = 0; i < 10; i++) {
+            corm_db_t* conn = corm_pool_checkout(pool);
+            CHECK(conn == mine, "round %d: got another connection from the first pool", i);
+            corm_pool_checkin(pool, conn);
+
+            conn = corm_pool_checkout(other);
+            CHECK(conn == other_mine, "round %d: got another connection from the second pool", i);
+            corm_pool_checkin(other, conn);
+        }
+        corm_pool_destroy(other);
+    }
+
+    corm_pool_destroy(pool);
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("pool: ok\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Read-only connections: queries from several threads run on the readers
+// while other threads keep writing, and a query that asks to read its own
+// writes sees rows still sitting in the write-behind buffer.
+//
+// make test
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int value;
+} Item;
+
+DEFINE_MODEL(Item, Item,
+    F_INT(Item, id, PRIMARY_KEY | AUTO_INC),
+    F_STRING(Item, name),
+    F_INT(Item, value)
+);
+
+#define DB_PATH "test_readers.db"
+#define READERS 2
+#define WRITER_THREADS 2
+#define READER_THREADS 4
+#define PER_WRITER 200
+#define BUFFERED_VALUE 99999
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    corm_db_t* db;
+    int failed;
+    int went_back;
+    char error[256];
+} worker_t;
+
+static volatile int writers_done;
+
+static int count_items(corm_db_t* db, bool read_your_writes) {
+    corm_query_t q;
+    corm_query_init(&q, db, &Item_model);
+    corm_query_read_your_writes(&q, read_your_writes);
+    corm_result_t* res = corm_query_exec(&q);
+    // No rows comes back as NULL without an error
+    int count = res ? res->count : corm_get_last_error(db)[0] ? -1 : 0;
+    corm_free_result(db, res);
+    return count;
+}
+
+static int count_buffered(corm_db_t* db, bool read_your_writes) {
+    int value = BUFFERED_VALUE;
+    void* params[] = { &value };
+    field_type_e types[] = { FIELD_TYPE_INT };
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Item_model);
+    corm_query_where(&q, "value = ?", params, types, 1);
+    corm_query_read_your_writes(&q, read_your_writes);
+    corm_result_t* res = corm_query_exec(&q);
+    int count = res ? res->count : corm_get_last_error(db)[0] ? -1 : 0;
+    corm_free_result(db, res);
+    return count;
+}
+
+static void* write_items(void* arg) {
+    worker_t* w = arg;
+    for (int i = 0; i < PER_WRITER; i++) {
+        Item item = { .name = "item", .value = i };
+        if (!corm_save(w->db, &Item_model, &item)) {
+            snprintf(w->error, sizeof(w->error), "%s", corm_get_last_error(w->db));
+            w->failed++;
+        }
+    }
+    __atomic_add_fetch(&writers_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Committed rows only ever add up, so a reader never sees fewer than before
+static void* read_items(void* arg) {
+    worker_t* w = arg;
+    int last = 0;
+    while (__atomic_load_n(&writers_done, __ATOMIC_ACQUIRE) < WRITER_THREADS) {
+        int count = count_items(w->db, false);
+        if (count < 0) {
+            snprintf(w->error, sizeof(w->error), "%s", corm_get_last_error(w->db));
+            w->failed++;
+            break;
+        }
+        if (count < last) w->went_back++;
+        last = count;
+    }
+    return NULL;
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+int main(void) {
+    remove_db();
+    // A busy timeout, the writer threads' connections take turns
+    corm_config_t config;
+    corm_config_preset("throughput", &config);
+    corm_db_t* db = corm_init_with_config(DB_PATH, &config);
+    if (!db || !corm_enable_readers(db, READERS)) {
+        printf("FAIL: setup: %s\n", db ? corm_get_last_error(db) : "corm_init");
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+    corm_register_model(db, &Item_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    // A buffered update isn't committed yet, so only the opt-out query sees it
+    Item buffered = { .name = "buffered", .value = 0 };
+    CHECK(corm_save(db, &Item_model, &buffered), "insert: %s", corm_get_last_error(db));
+    CHECK(corm_write_behind_enable(db, 16, 60000), "write-behind: %s", corm_get_last_error(db));
+    buffered.value = BUFFERED_VALUE;
+    CHECK(corm_save(db, &Item_model, &buffered), "buffered save: %s", corm_get_last_error(db));
+    CHECK(count_buffered(db, false) == 0, "a reader saw an uncommitted row");
+    CHECK(count_buffered(db, true) == 1, "read-your-writes query missed the buffered row");
+    CHECK(corm_write_behind_disable(db), "disable write-behind: %s", corm_get_last_error(db));
+    CHECK(count_buffered(db, false) == 1, "a reader missed a flushed row");
+
+    CHECK(corm_set_shared(db, true), "shared: %s", corm_get_last_error(db));
+
+    worker_t writers[WRITER_THREADS];
+    worker_t readers[READER_THREADS];
+    pthread_t writer_threads[WRITER_THREADS];
+    pthread_t reader_threads[READER_THREADS];
+    for (int t = 0; t < READER_THREADS; t++) {
+        readers[t] = (worker_t){ .db = db };
+        pthread_create(&reader_threads[t], NULL, read_items, &readers[t]);
+    }
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        writers[t] = (worker_t){ .db = db };
+        pthread_create(&writer_threads[t], NULL, write_items, &writers[t]);
+    }
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        pthread_join(writer_threads[t], NULL);
+        CHECK(writers[t].failed == 0, "writer %d had %d saves fail: %s", t, writers[t].failed, writers[t].error);
+    }
+    for (int t = 0; t < READER_THREADS; t++) {
+        pthread_join(reader_threads[t], NULL);
+        CHECK(readers[t].failed == 0, "reader %d had a query fail: %s", t, readers[t].error);
+        CHECK(readers[t].went_back == 0, "reader %d saw the row count drop %d times", t, readers[t].went_back);
+    }
+
+    int expected = 1 + WRITER_THREADS * PER_WRITER;
+    CHECK(count_items(db, false) == expected, "expected %d rows, got %d", expected, count_items(db, false));
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("readers: ok\n");
+    return 0;
+}
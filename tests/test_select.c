@@ -0,0 +1,105 @@
+// A statement from corm_select_prepare stays usable while the connection
+// runs other queries: a second select of the same shape gets its own, and
+// filling the statement cache doesn't finalize it.
+//
+// make test
+
+#include <stdio.h>
+#include "corm.h"
+#include "corm_backend.h"
+
+typedef struct {
+    int id;
+    int age;
+} Person;
+
+DEFINE_MODEL(Person, Person,
+    F_INT(Person, id, PRIMARY_KEY),
+    F_INT(Person, age)
+);
+
+#define ROWS 10
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static const char* columns[] = { "id", "age" };
+static const field_type_e int_param[] = { FIELD_TYPE_INT };
+
+static corm_backend_stmt_t select_older(corm_db_t* conn, int min_age) {
+    corm_backend_stmt_t stmt = corm_select_prepare(conn, &Person_model, columns, 2, "age >= ?", int_param, 1);
+    if (stmt) conn->backend->bind_int(stmt, 1, min_age);
+    return stmt;
+}
+
+int main(void) {
+    corm_db_t* db = corm_init(":memory:");
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Person_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        return 1;
+    }
+    for (int i = 0; i < ROWS; i++) {
+        Person p = { .id = i + 1, .age = i };
+        CHECK(corm_save(db, &Person_model, &p), "insert: %s", corm_get_last_error(db));
+    }
+
+    corm_db_t* conn = corm_connection(db);
+    const corm_backend_ops_t* ops = conn->backend;
+
+    corm_backend_stmt_t first = select_older(conn, 0);
+    CHECK(first, "prepare: %s", corm_get_last_error(conn));
+    CHECK(first && ops->step(first) == CORM_STEP_ROW, "first row");
+
+    // Same shape while the first is mid-way: a different statement
+    corm_backend_stmt_t second = select_older(conn, 5);
+    CHECK(second && second != first, "second select got the lent statement");
+    int second_rows = 0;
+    while (second && ops->step(second) == CORM_STEP_ROW) second_rows++;
+    CHECK(second_rows == ROWS - 5, "second select saw %d rows", second_rows);
+    corm_select_release(conn, second);
+
+    // More distinct queries than the cache holds
+    for (int i = 0; i < CORM_STMT_CACHE_CAPACITY + 10; i++) {
+        char where[64];
+        snprintf(where, sizeof(where), "age >= %d", i);
+        corm_query_t q;
+        corm_query_init(&q, db, &Person_model);
+        corm_query_where(&q, where, NULL, NULL, 0);
+        corm_free_result(db, corm_query_exec(&q));
+    }
+
+    // The first statement was neither rebound nor finalized
+    int first_rows = 1;
+    while (first && ops->step(first) == CORM_STEP_ROW) first_rows++;
+    CHECK(first_rows == ROWS, "first select saw %d rows", first_rows);
+    corm_select_release(conn, first);
+
+    // Back in the cache: the next select of that shape reuses it
+    corm_backend_stmt_t again = select_older(conn, 0);
+    CHECK(again == first, "released statement wasn't reused");
+    corm_select_release(conn, again);
+
+    corm_close(db);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("select: ok\n");
+    return 0;
+}
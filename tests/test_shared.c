@@ -0,0 +1,137 @@
+// Shared handles: several threads save and query through one corm_db_t, each
+// on its own connection with its own last error.
+//
+// make test
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int owner;
+} Note;
+
+DEFINE_MODEL(Note, Note,
+    F_INT(Note, id, PRIMARY_KEY | AUTO_INC),
+    F_STRING(Note, name),
+    F_INT(Note, owner)
+);
+
+#define DB_PATH "test_shared.db"
+#define THREADS 4
+#define PER_THREAD 100
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    corm_db_t* db;
+    int owner;
+    int failed;
+    int wrong_count;
+    int own_connection;
+    char error[256];
+} worker_t;
+
+static int count_notes(corm_db_t* db, int owner) {
+    void* params[] = { &owner };
+    field_type_e types[] = { FIELD_TYPE_INT };
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Note_model);
+    corm_query_where(&q, "owner = ?", params, types, 1);
+    corm_result_t* res = corm_query_exec(&q);
+    int count = res ? res->count : -1;
+    corm_free_result(db, res);
+    return count;
+}
+
+// Saves rows of its own and checks that it always sees all of them
+static void* work(void* arg) {
+    worker_t* w = arg;
+    w->own_connection = corm_connection(w->db) != w->db;
+    for (int i = 0; i < PER_THREAD; i++) {
+        Note note = { .name = "note", .owner = w->owner };
+        if (!corm_save(w->db, &Note_model, &note)) {
+            snprintf(w->error, sizeof(w->error), "%s", corm_get_last_error(w->db));
+            w->failed++;
+            continue;
+        }
+        if (count_notes(w->db, w->owner) != i + 1 - w->failed) w->wrong_count++;
+    }
+
+    // An error on this thread isn't seen by the others
+    corm_query_t q;
+    corm_query_init(&q, w->db, &Note_model);
+    corm_query_where(&q, "no_such_column = 1", NULL, NULL, 0);
+    corm_free_result(w->db, corm_query_exec(&q));
+    if (!corm_get_last_error(w->db)[0]) w->failed++;
+    return NULL;
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+int main(void) {
+    remove_db();
+    // WAL with a busy timeout, the threads' connections write concurrently
+    corm_config_t config;
+    corm_config_preset("throughput", &config);
+    corm_db_t* db = corm_init_with_config(DB_PATH, &config);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Note_model);
+    if (!corm_sync(db, CORM_SYNC_DROP) || !corm_set_shared(db, true)) {
+        printf("FAIL: setup: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    worker_t workers[THREADS];
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        workers[t] = (worker_t){ .db = db, .owner = t };
+        pthread_create(&threads[t], NULL, work, &workers[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(workers[t].own_connection, "thread %d used the handle's own connection", t);
+        CHECK(workers[t].failed == 0, "thread %d had %d saves fail: %s", t, workers[t].failed, workers[t].error);
+        CHECK(workers[t].wrong_count == 0, "thread %d missed its own rows %d times", t, workers[t].wrong_count);
+    }
+
+    // The main thread's last error wasn't touched by the workers' bad queries
+    CHECK(!corm_get_last_error(db)[0], "main thread sees an error: %s", corm_get_last_error(db));
+    for (int t = 0; t < THREADS; t++) {
+        CHECK(count_notes(db, t) == PER_THREAD, "owner %d has %d rows", t, count_notes(db, t));
+    }
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("shared: ok\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+// CORM_SYNC_SAFE with an unchanged schema skips the DDL, but still creates
+// tables that were dropped or renamed outside corm since the last sync.
+//
+// make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "corm.h"
+#include "corm_backend.h"
+
+typedef struct {
+    int id;
+    char* name;
+} Person;
+
+DEFINE_MODEL(Person, Person,
+    F_INT(Person, id, PRIMARY_KEY),
+    F_STRING(Person, name)
+);
+
+typedef struct {
+    int id;
+    char* title;
+} Note;
+
+DEFINE_MODEL(Note, Note,
+    F_INT(Note, id, PRIMARY_KEY),
+    F_STRING(Note, title)
+);
+
+#define DB_PATH "test_sync.db"
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static corm_db_t* open_synced(void) {
+    corm_db_t* db = corm_init(DB_PATH);
+    if (!db) return NULL;
+    corm_register_model(db, &Person_model);
+    corm_register_model(db, &Note_model);
+    if (!corm_sync(db, CORM_SYNC_SAFE)) {
+        CHECK(false, "sync: %s", corm_get_last_error(db));
+    }
+    return db;
+}
+
+static bool execute(corm_db_t* db, const char* sql) {
+    char* error = NULL;
+    bool ok = db->backend->execute(db->backend_conn, sql, &error);
+    if (!ok) printf("%s: %s\n", sql, error ? error : "unknown error");
+    free(error);
+    return ok;
+}
+
+int main(void) {
+    unlink(DB_PATH);
+
+    corm_db_t* db = open_synced();
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    Person person = { .id = 1, .name = "someone" };
+    Note note = { .id = 1, .title = "first" };
+    CHECK(corm_save(db, &Person_model, &person), "save: %s", corm_get_last_error(db));
+    CHECK(corm_save(db, &Note_model, &note), "save: %s", corm_get_last_error(db));
+
+    // Outside corm: one table goes away, another gets a new name
+    CHECK(execute(db, "DROP TABLE Person"), "drop");
+    CHECK(execute(db, "ALTER TABLE Note RENAME TO OldNote"), "rename");
+    corm_close(db);
+
+    // Same models, so the fingerprint still matches
+    db = open_synced();
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        unlink(DB_PATH);
+        return 1;
+    }
+    CHECK(corm_save(db, &Person_model, &person), "Person wasn't recreated: %s", corm_get_last_error(db));
+    CHECK(corm_save(db, &Note_model, &note), "Note wasn't recreated: %s", corm_get_last_error(db));
+    corm_close(db);
+
+    unlink(DB_PATH);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("sync: ok\n");
+    return 0;
+}
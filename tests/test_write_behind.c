@@ -0,0 +1,105 @@
+// A flush that fails keeps the write-behind queue, a full queue refuses new
+// keys instead of growing, and corm_write_behind_discard gets the handle
+// writing again.
+//
+// make test
+
+#include <stdio.h>
+#include <string.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* email;
+} Account;
+
+DEFINE_MODEL(Account, Account,
+    F_INT(Account, id, PRIMARY_KEY),
+    F_STRING(Account, email, NOT_NULL | UNIQUE)
+);
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+static int count_accounts(corm_db_t* db) {
+    corm_query_t q;
+    corm_query_init(&q, db, &Account_model);
+    corm_result_t* res = corm_query_exec(&q);
+    int count = res ? res->count : 0;
+    corm_free_result(db, res);
+    return count;
+}
+
+static int queued(corm_db_t* db) {
+    corm_stats_t stats;
+    corm_get_stats(db, &stats);
+    return (int)stats.write_buffer_depth;
+}
+
+int main(void) {
+    corm_db_t* db = corm_init(":memory:");
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+
+    corm_register_model(db, &Account_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        return 1;
+    }
+
+    CHECK(corm_write_behind_enable(db, 2, 0), "enable: %s", corm_get_last_error(db));
+
+    // Two keys with the same UNIQUE email fill the queue and fail its flush
+    Account a = { .id = 1, .email = "same@example.com" };
+    Account b = { .id = 2, .email = "same@example.com" };
+    CHECK(corm_save(db, &Account_model, &a), "first save: %s", corm_get_last_error(db));
+    CHECK(!corm_save(db, &Account_model, &b), "second save should fail its flush");
+    CHECK(queued(db) == 2, "failed flush should keep the queue, depth %d", queued(db));
+
+    // A new key doesn't fit, an existing one still coalesces
+    Account c = { .id = 3, .email = "c@example.com" };
+    CHECK(!corm_save(db, &Account_model, &c), "save into a full queue should fail");
+    CHECK(strstr(corm_get_last_error(db), "Write buffer is full"), "unexpected error: %s", corm_get_last_error(db));
+    CHECK(queued(db) == 2, "full queue grew to %d", queued(db));
+
+    // Direct writes retry the batch and fail with it
+    int id = 1;
+    CHECK(!corm_delete(db, &Account_model, &id), "delete should fail behind the stuck batch");
+    CHECK(!corm_write_behind_disable(db), "disable should fail while the batch can't be written");
+
+    // Fixing a queued row lets the batch through
+    b.email = "b@example.com";
+    CHECK(corm_save(db, &Account_model, &b), "fixing save: %s", corm_get_last_error(db));
+    CHECK(corm_flush(db), "flush: %s", corm_get_last_error(db));
+    CHECK(count_accounts(db) == 2, "expected 2 rows, got %d", count_accounts(db));
+
+    // Or the batch can be dropped
+    Account d = { .id = 4, .email = "same@example.com" };
+    CHECK(!corm_save(db, &Account_model, &d) || !corm_flush(db), "conflicting row should fail to flush");
+    CHECK(corm_write_behind_discard(db) == 1, "discard should drop the one pending write");
+    CHECK(queued(db) == 0, "queue depth %d after discard", queued(db));
+    CHECK(corm_save(db, &Account_model, &c), "save after discard: %s", corm_get_last_error(db));
+    CHECK(corm_write_behind_disable(db), "disable: %s", corm_get_last_error(db));
+    CHECK(count_accounts(db) == 3, "expected 3 rows, got %d", count_accounts(db));
+
+    corm_close(db);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("write-behind: ok\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+// The single writer queue: writes from several producer threads, with and
+// without futures, have all landed once the writer is stopped, and sizes the
+// writer can't work with are rejected up front.
+//
+// make test
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int value;
+} Event;
+
+DEFINE_MODEL(Event, Event,
+    F_INT(Event, id, PRIMARY_KEY),
+    F_STRING(Event, name),
+    F_INT(Event, value)
+);
+
+#define DB_PATH "test_writer.db"
+#define THREADS 4
+#define PER_THREAD 500
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct {
+    corm_writer_t* writer;
+    int first_id;
+    int rejected;
+    int failed;
+} producer_t;
+
+// Even rows are fire and forget, odd ones wait on a future
+static void* produce(void* arg) {
+    producer_t* p = arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        Event e = { .id = p->first_id + i, .name = "event", .value = i };
+        if (i % 2 == 0) {
+            if (!corm_writer_save(p->writer, &Event_model, &e, NULL, 0)) p->rejected++;
+            continue;
+        }
+        corm_write_future_t f;
+        if (!corm_writer_save(p->writer, &Event_model, &e, &f, 0)) p->rejected++;
+        if (!corm_write_future_wait(&f)) p->failed++;
+    }
+    return NULL;
+}
+
+static int count_events(corm_db_t* db) {
+    corm_query_t q;
+    corm_query_init(&q, db, &Event_model);
+    corm_result_t* res = corm_query_exec(&q);
+    int count = res ? res->count : 0;
+    corm_free_result(db, res);
+    return count;
+}
+
+static void remove_db(void) {
+    unlink(DB_PATH);
+    unlink(DB_PATH "-wal");
+    unlink(DB_PATH "-shm");
+}
+
+int main(void) {
+    remove_db();
+    corm_db_t* db = corm_init(DB_PATH);
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+    corm_register_model(db, &Event_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    CHECK(!corm_writer_start(db, 16, 0), "max_batch 0 should be rejected");
+    CHECK(!corm_writer_start(db, 16, 17), "max_batch above capacity should be rejected");
+    CHECK(!corm_writer_start(db, (size_t)-1, 16), "huge capacity should be rejected");
+
+    corm_writer_t* writer = corm_writer_start(db, 64, 32);
+    CHECK(writer, "start: %s", corm_get_last_error(db));
+    if (!writer) {
+        corm_close(db);
+        remove_db();
+        return 1;
+    }
+
+    producer_t producers[THREADS];
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        producers[t] = (producer_t){ .writer = writer, .first_id = 1 + t * PER_THREAD };
+        pthread_create(&threads[t], NULL, produce, &producers[t]);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        CHECK(producers[t].rejected == 0, "thread %d had %d writes rejected", t, producers[t].rejected);
+        CHECK(producers[t].failed == 0, "thread %d had %d writes fail", t, producers[t].failed);
+    }
+
+    // Stopping drains the fire-and-forget writes still in the ring
+    corm_writer_stop(writer);
+    CHECK(count_events(db) == THREADS * PER_THREAD, "expected %d rows, got %d",
+          THREADS * PER_THREAD, count_events(db));
+
+    corm_close(db);
+    remove_db();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("writer: ok\n");
+    return 0;
+}
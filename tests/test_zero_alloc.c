@@ -0,0 +1,201 @@
+// After a warmup, find-by-primary-key, filtered queries and saves of existing
+// rows make no calls to corm's allocator (see "Repeated Queries" in README.md),
+// even while one-off queries churn through the statement cache.
+//
+// make test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "corm.h"
+
+typedef struct {
+    int id;
+    char* name;
+    int age;
+} Person;
+
+DEFINE_MODEL(Person, Person,
+    F_INT(Person, id, PRIMARY_KEY | AUTO_INC),
+    F_STRING(Person, name),
+    F_INT(Person, age)
+);
+
+typedef struct {
+    int id;
+    char* label;
+    int64_t total;
+} Counter;
+
+#define COUNTER_FIELDS(X) \
+    X(INT, Counter, id, PRIMARY_KEY | AUTO_INC) \
+    X(STRING, Counter, label) \
+    X(INT64, Counter, total)
+
+DEFINE_MODEL_FAST(Counter, Counter, COUNTER_FIELDS);
+
+#define ROWS 50
+#define WARMUP 10
+#define ROUNDS 200
+
+static size_t allocations;
+
+// Blocks start past a header of their own, so handing one to the wrong
+// free (or a malloc'd one to counting_free) doesn't go unnoticed
+#define HEADER 16
+
+static void* counting_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    allocations++;
+    char* block = malloc(HEADER + size);
+    return block ? block + HEADER : NULL;
+}
+
+static void counting_free(void* ctx, void* ptr) {
+    (void)ctx;
+    if (ptr) free((char*)ptr - HEADER);
+}
+
+static int failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            failures++; \
+        } \
+    } while (0)
+
+// Runs op ROUNDS times and checks that the runs after WARMUP didn't allocate
+#define CHECK_NO_ALLOCS(what, op) \
+    do { \
+        size_t before = 0; \
+        for (int round = 0; round < ROUNDS; round++) { \
+            if (round == WARMUP) before = allocations; \
+            if (!(op)) { \
+                CHECK(false, "%s failed: %s", what, corm_get_last_error(db)); \
+                break; \
+            } \
+        } \
+        CHECK(allocations == before, "%s allocated %zu times after warmup", what, allocations - before); \
+    } while (0)
+
+static bool find_person(corm_db_t* db, corm_result_t** res, int round) {
+    int id = 1 + round % ROWS;
+    void* params[] = { &id };
+    field_type_e types[] = { FIELD_TYPE_INT };
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Person_model);
+    corm_query_where(&q, "id = ?", params, types, 1);
+    return corm_query_exec_into(&q, res) && (*res)->count == 1 && ((Person*)(*res)->data)->id == id;
+}
+
+static bool filter_people(corm_db_t* db, corm_result_t** res, int round) {
+    // Alternates between a short and a long result
+    int min_age = round % 2 ? 40 : 10;
+    void* params[] = { &min_age };
+    field_type_e types[] = { FIELD_TYPE_INT };
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Person_model);
+    corm_query_where(&q, "age > ?", params, types, 1);
+    corm_query_order_by(&q, "age DESC");
+    return corm_query_exec_into(&q, res) && (*res)->count == ROWS - 1 - min_age;
+}
+
+static bool save_person(corm_db_t* db, Person* person, int round) {
+    person->age = round;
+    person->name = round % 2 ? "odd" : "even";
+    return corm_save(db, &Person_model, person);
+}
+
+// A query with its value spelled into the WHERE text, a shape of its own
+static void one_off_query(corm_db_t* db, int round) {
+    char where[64];
+    snprintf(where, sizeof(where), "age = %d", 1000 + round);
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Person_model);
+    corm_query_where(&q, where, NULL, NULL, 0);
+    corm_free_result(db, corm_query_exec(&q));
+}
+
+static bool find_counter(corm_db_t* db, corm_result_t** res, int round) {
+    int id = 1 + round % ROWS;
+    void* params[] = { &id };
+    field_type_e types[] = { FIELD_TYPE_INT };
+
+    corm_query_t q;
+    corm_query_init(&q, db, &Counter_model);
+    corm_query_where(&q, "id = ?", params, types, 1);
+    return corm_query_exec_into(&q, res) && (*res)->count == 1;
+}
+
+static bool save_counter(corm_db_t* db, Counter* counter, int round) {
+    counter->total = round;
+    return corm_save(db, &Counter_model, counter);
+}
+
+int main(void) {
+    corm_db_t* db = corm_init(":memory:");
+    if (!db) {
+        printf("FAIL: corm_init\n");
+        return 1;
+    }
+
+    corm_register_model(db, &Person_model);
+    corm_register_model(db, &Counter_model);
+    if (!corm_sync(db, CORM_SYNC_DROP)) {
+        printf("FAIL: corm_sync: %s\n", corm_get_last_error(db));
+        corm_close(db);
+        return 1;
+    }
+    corm_set_allocator(db, NULL, counting_alloc, counting_free);
+
+    for (int i = 0; i < ROWS; i++) {
+        Person person = { .name = "someone", .age = i };
+        Counter counter = { .label = "hits", .total = i };
+        CHECK(corm_save(db, &Person_model, &person), "insert: %s", corm_get_last_error(db));
+        CHECK(corm_save(db, &Counter_model, &counter), "insert: %s", corm_get_last_error(db));
+    }
+
+    corm_result_t* found = NULL;
+    corm_result_t* filtered = NULL;
+    corm_result_t* counters = NULL;
+    Person person = { .id = 2 };
+    Counter counter = { .id = 3, .label = "hits" };
+
+    CHECK_NO_ALLOCS("find by primary key", find_person(db, &found, round));
+    CHECK_NO_ALLOCS("filtered query", filter_people(db, &filtered, round));
+    CHECK_NO_ALLOCS("save", save_person(db, &person, round));
+    CHECK_NO_ALLOCS("find by primary key (DEFINE_MODEL_FAST)", find_counter(db, &counters, round));
+    CHECK_NO_ALLOCS("save (DEFINE_MODEL_FAST)", save_counter(db, &counter, round));
+
+    // Far more one-off queries than the statement cache holds don't push
+    // out the statement of a query that keeps running
+    size_t hot_allocations = 0;
+    for (int round = 0; round < CORM_STMT_CACHE_CAPACITY * 3; round++) {
+        one_off_query(db, round);
+        size_t before = allocations;
+        if (!find_person(db, &found, round)) {
+            CHECK(false, "find between one-off queries failed: %s", corm_get_last_error(db));
+            break;
+        }
+        hot_allocations += allocations - before;
+    }
+    CHECK(hot_allocations == 0, "find between one-off queries allocated %zu times", hot_allocations);
+
+    corm_free_result(db, found);
+    corm_free_result(db, filtered);
+    corm_free_result(db, counters);
+    corm_close(db);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("zero-alloc: ok\n");
+    return 0;
+}